@@ -1,55 +1,116 @@
 #include "src/main.hpp"
 #include <cstring>
 #include <stdlib.h>
+#include <iomanip>
 using namespace std;
 
-// Return the formatted string for the elapsed time
-// @param duration  time in microseconds
+/*
+ * PHASE-RESOLVED BENCHMARK OF THE TWO ALGORITHMS
+ */
+
+// Timings of the phases of an algorithm, in nanoseconds (one entry per run)
+struct phase_times {
+    vector<string> names; // Names of the phases
+    vector<vector<uint64_t>> runs; // Timings of each phase
+
+    // Initialize the container
+    // @param n             names of the phases
+    void init(const vector<string> &n) {
+        names = n; names.pb("total");
+        runs = vector<vector<uint64_t>>(names.size());
+    }
+
+    // Record a run
+    // @param tp            time points at the boundaries of the phases
+    void add(const vector<chrono::high_resolution_clock::time_point> &tp) {
+        for (size_t i = 0; i+1 < tp.size(); ++i) runs[i].pb(chrono::duration_cast<chrono::nanoseconds>(tp[i+1]-tp[i]).count());
+        runs.back().pb(0);
+        for (size_t i = 0; i+1 < runs.size(); ++i) runs.back().back() += runs[i].back();
+    }
+};
+
+// Summary of a set of timings
+struct stats {
+    uint64_t min = 0, median = 0, p95 = 0;
+};
+
+// Compute the summary of a set of timings [nearest-rank percentiles]
+// @param v         timings
+// @return          summary
+inline struct stats summarize(vector<uint64_t> v) { // Complexity: O(k*log(k)) where k = v.size()
+    struct stats s;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    s.min = v[0];
+    s.median = v[(v.size()+1)/2 - 1];
+    s.p95 = v[(95*v.size()+99)/100 - 1];
+    return s;
+}
+
+// Format a time in nanoseconds as microseconds
+// @param ns        time in nanoseconds
 // @return          formatted string
-inline string printDuration(const uint64_t duration) {
-    int us = duration; // Microseconds
-    int ms = us/1000; us %= 1000; // Milliseconds
-    int s = ms / 1000; ms %= 1000; // Seconds
-    int m = s/60; s %= 60; // Minutes
-    int h = m/60; m %= 60; // Hours
-    oss os; os << h << "h " << m << "m " << s << "s " << ms << "ms " << us << "us"; // Format string
+inline string printUs(const uint64_t ns) {
+    oss os; os << fixed << setprecision(3) << ns/1000.0 << "us";
     return os.str();
 }
 
 // Perform standard centroid decomposition
-// @param t         minimal representation of input tree
+// @param w         input tree
 // @param check     perform correctness check?
-// @return          execution time
-inline uint32_t nlognCD(vector<uint32_t> t, const bool check) { // Complexity: O(n*log(n))
-    chrono::high_resolution_clock::time_point t01 = getTime();
-    uint32_t n = sizeOfT(t); // Number of nodes
+// @param times     timings of the phases [nullptr for warmup runs]
+inline void nlognCD(const struct bp_writer &w, const bool check, struct phase_times *times) { // Complexity: O(n*log(n))
+    vector<chrono::high_resolution_clock::time_point> tp;
+    struct bp_header h = w.header();
+    tp.pb(getTime());
+    vector<uint32_t> t = buildTree<uint32_t>(h, w.bits.data());
+    tp.pb(getTime());
     vector<uint32_t> id_ref = buildIdRef(t);
+    tp.pb(getTime());
     computeSizes(t, id_ref);
-    vector<uint32_t> t_cp;
-    if (check) t_cp = t; // Copy tree for correctness check
-    struct c_tree ct = stdCentroidDecomposition(t);
-    uint32_t time = chrono::duration_cast<chrono::microseconds>(getTime()-t01).count();
-    if (check) cerr << "O(n*log(n)) - " << n << " nodes - correct: " << ((checkCorrectness(t_cp, ct))? "true" : "false") << nl;
-    return time;
+    tp.pb(getTime());
+    c_tree ct = stdCentroidDecomposition(t);
+    tp.pb(getTime());
+    if (times) times->add(tp);
+    if (check && times) cerr << "O(n*log(n)) - " << h.n << " nodes - correct: " << ((checkCorrectness(ct, id_ref, t.size()))? "true" : "false") << nl;
 }
 
 // Perform linear centroid decomposition
-// @param t         minimal representation of input tree
+// @param w         input tree
 // @param check     perform correctness check?
-// @param A         size of subtrees [log(n) if not given]
-// @param B         linear centroid decomposition threshold [log^3(n) if not given]
-// @return          execution time
-inline uint32_t nCD(vector<uint32_t> t, const bool check, const uint32_t A, const uint32_t B) { // Complexity: O(n)
-    chrono::high_resolution_clock::time_point t01 = getTime();
-    uint32_t n = sizeOfT(t); // Number of nodes
+// @param A         size of subtrees [log(n) if 0]
+// @param B         linear centroid decomposition threshold [log^3(n) if 0]
+// @param relabel   use the treelet-contiguous layout of T?
+// @param times     timings of the phases [nullptr for warmup runs]
+// @param perf      report in which to measure the cache misses of the decomposition [optional]
+inline void nCD(const struct bp_writer &w, const bool check, const uint32_t A, const uint32_t B, const bool relabel, struct phase_times *times, struct perf_report *perf = nullptr) { // Complexity: O(n)
+    vector<chrono::high_resolution_clock::time_point> tp;
+    struct bp_header h = w.header();
+    tp.pb(getTime());
+    vector<uint32_t> t = buildTree<uint32_t>(h, w.bits.data());
+    tp.pb(getTime());
     vector<uint32_t> id_ref = buildIdRef(t);
+    tp.pb(getTime());
     vector<uint32_t> t2 = cover(t, id_ref, A);
-    vector<uint32_t> t_cp;
-    if (check) t_cp = t; // Copy tree for correctness check
-    struct c_tree ct = centroidDecomposition(t, t2, B);
-    uint32_t time = chrono::duration_cast<chrono::microseconds>(getTime()-t01).count();
-    if (check) cerr << "O(n) - " << n << " nodes - correct: " << ((checkCorrectness(t_cp, ct))? "true" : "false") << nl;
-    return time;
+    tp.pb(getTime());
+    struct treelet_layout<uint32_t> lay;
+    if (relabel) { lay = relabelTree(t, t2); tp.pb(getTime()); }
+    c_tree ct;
+    { perf_scope ps(((times)? perf : nullptr), "decomposition"); ct = centroidDecomposition(t, t2, B); }
+    if (relabel) lay.restoreIds(ct.ids, t);
+    tp.pb(getTime());
+    if (times) times->add(tp);
+    if (check && times) cerr << "O(n)" << ((relabel)? " [treelet layout]" : "") << " - " << h.n << " nodes - correct: " << ((checkCorrectness(ct, id_ref, t.size()))? "true" : "false") << nl;
+}
+
+// Print the cache misses of the decomposition, per run
+// @param name      name of the layout
+// @param r         report
+inline void printMisses(const string &name, const struct perf_report &r) {
+    cout << " - " << name << ": ";
+    if (!r.counters || r.p.empty() || !r.p[0].calls) { cout << "n/a (" << r.c.err << ")" << nl; return; }
+    for (uint32_t e : {2u, 4u}) cout << ((e == 2)? "" : ", ") << perf_names[e] << " " << ((r.c.available(e))? to_string(r.p[0].v[e] / r.p[0].calls) : "n/a");
+    cout << nl;
 }
 
 // Print help
@@ -57,40 +118,56 @@ void help() {
 	cout << "Usage: benchmark [options]" << nl <<
 	"Options:" << nl <<
 	" -h        Print this help." << nl <<
-    " -g <arg>  Tree generator. Options: random, path, chains." << nl <<
-    " -k <arg>  Additional parameter for tree generator. [OPTIONAL]" << nl <<
-    " -b <arg>  Number of nodes of smallest tree [REQUIRED]." << nl <<
-    " -e <arg>  Number of nodes of biggest tree [REQUIRED]." << nl <<
-    " -s <arg>  Increment step [REQUIRED]." << nl <<
-    " -t <arg>  Number of tests for each tree [REQUIRED]." << nl <<
+	" -g <arg>  Tree generator. Options: random, path, chains, binary_halfn, star, caterpillar, broom." << nl <<
+	" -k <arg>  Additional parameter for tree generator. [OPTIONAL]" << nl <<
+	" -b <arg>  Number of nodes of smallest tree [REQUIRED]." << nl <<
+	" -e <arg>  Number of nodes of biggest tree [REQUIRED]." << nl <<
+	" -s <arg>  Increment step [REQUIRED]." << nl <<
+	" -t <arg>  Number of timed runs for each tree [REQUIRED]." << nl <<
+	" -W <arg>  Number of warmup runs for each tree [default: 1]." << nl <<
+	" -S <arg>  Random seed of the tree generator [default: 1]." << nl <<
+	" -A <arg>  Size of trelets for tree covering [default: log(n)]." << nl <<
+	" -B <arg>  Threshold for linear centroid decomposition [default: log^3(n)]." << nl <<
+	" -T        Auto-tune A and B for each tree (explicit -A and -B take precedence)." << nl <<
+	" -L        Also run the linear algorithm on the treelet-contiguous layout of T, and compare the cache misses of the two layouts." << nl <<
+	" -C <arg>  Write the results to a CSV file." << nl <<
+	" -J <arg>  Write the results to a JSON file." << nl <<
 	" -c        Check correctness." << nl;
 	exit(0);
 }
 
 // General options
-string g = "random";
-uint32_t start = 0, stop = 0, step = 0, tests = 0;
-bool check = false; // Perform correctness check?
-uint32_t A = 1000;
-uint32_t B = 1000;
+string g = "random", csv_path, json_path;
+uint32_t start = 0, stop = 0, step = 0, tests = 0, warmup = 1;
+uint64_t seed = 1;
+bool check = false, tune = false, relabel = false; // Perform correctness check? Auto-tune? Compare the treelet layout?
+uint32_t A = 0;
+uint32_t B = 0;
 uint32_t k = 1; // Additional parameter for some tree generators
-string tree;
-vector<uint32_t> t;
+
+// One row of the results
+struct result {
+    uint32_t n, A, B;
+    string algorithm, phase; // Algorithm ("std", "lin", or "lin-treelet") and phase
+    struct stats s;
+};
+vector<struct result> results;
 
 int main(int argc, char* argv[]) {
-    // Process command line options
+	// Process command line options
 	int opt;
-	while ((opt = getopt(argc, argv, "hg:k:b:e:s:t:c")) != -1) {
+	while ((opt = getopt(argc, argv, "hg:k:b:e:s:t:W:S:A:B:TLC:J:c")) != -1) {
 		switch (opt) {
 			case 'h':
 				help();
 				break;
-            case 'g':
-                if (strcmp("random", optarg) == 0 || strcmp("path", optarg) == 0 || strcmp("chains", optarg) == 0) g = optarg;
-                break;
-            case 'k':
-                k = atoi(optarg);
-                break;
+			case 'g':
+				if (std::find(generators.begin(), generators.end(), string(optarg)) != generators.end()) g = optarg;
+				else help();
+				break;
+			case 'k':
+				k = atoi(optarg);
+				break;
 			case 'b':
 				start = atoi(optarg);
 				break;
@@ -103,6 +180,30 @@ int main(int argc, char* argv[]) {
 			case 't':
 				tests = atoi(optarg);
 				break;
+			case 'W':
+				warmup = atoi(optarg);
+				break;
+			case 'S':
+				seed = strtoull(optarg, nullptr, 10);
+				break;
+			case 'A':
+				A = atoi(optarg);
+				break;
+			case 'B':
+				B = atoi(optarg);
+				break;
+			case 'T':
+				tune = true;
+				break;
+			case 'L':
+				relabel = true;
+				break;
+			case 'C':
+				csv_path = string(optarg);
+				break;
+			case 'J':
+				json_path = string(optarg);
+				break;
 			case 'c':
 				check = true;
 				break;
@@ -111,31 +212,72 @@ int main(int argc, char* argv[]) {
 				return -1;
 		}
 	}
-    if (!start || !stop || !step || !tests || stop < start) help(); // If incorrect parameters
-    // Benchmark
-    for (uint32_t n = start; n <= stop; n += step) {
-        uint32_t t01 = 0, t02 = 0;
-        for (uint32_t i = 0; i < tests; ++i) { // Loop 'tests' times
-            if (g.compare("random") == 0)
-                auto r = system(("tree_gen/" + g + " " + to_string(n) + " > tree.txt").c_str()); // Generate ree
-            else
-                auto r = system(("tree_gen/" + g + " " + to_string(n) + " " + to_string(k) + " > tree.txt").c_str()); // Generate ree
-            ifstream in("tree.txt"); in >> tree; in.close();
-            try {
-                t = buildTree(tree); // Build tree (minimal representation)
-            } catch (const char* err) {
-                cout << err << nl;
-                return 0;
-            }
-            t01 += nlognCD(t, check); // Perform O(n*log(n)) centroid decomposition
-            t02 += nCD(t, check, A, B); // Perform O(n) centroid decomposition
-        }
-        t01 /= tests; t02 /= tests; // Compute average of 'tests' decompositions (both)
-        cout << "O(n*log(n)) - " << n << " nodes - time: " << t01 << " -  formatted: " << printDuration(t01) << nl;
-        cout << "O(n) - " << n << " nodes - time: " << t02 << " - formatted: " << printDuration(t02) << nl << nl;
-        if (!check) cerr << "Done for " << n << " nodes." << nl;
-        else cerr << nl;
-    }
-    auto r = system("rm -rf tree.txt"); // Delete 'tree.txt' temporary file
-    return 0;
-}
\ No newline at end of file
+	if (!start || !stop || !step || !tests || stop < start) help(); // If incorrect parameters
+	// Benchmark
+	for (uint32_t n = start; n <= stop; n += step) {
+		struct bp_writer w;
+		uint32_t a = A, b = B;
+		try {
+			generateTree(w, g, n, k, seed); // Same tree for each run
+			if (tune) {
+				vector<uint32_t> t = buildTree<uint32_t>(w.header(), w.bits.data());
+				struct cd_profile prof = tuneParameters(t);
+				a = ((a)? a : prof.A); b = ((b)? b : prof.B);
+			}
+			uint32_t lg = ((n <= 1)? 1 : log2(n));
+			a = ((a)? a : lg); b = ((b)? b : lg*lg*lg); // Defaults of 'cover()' and 'centroidDecomposition()'
+			struct phase_times t01, t02, t03;
+			struct perf_report p02, p03; // Cache misses of the decomposition on the BFS and on the treelet layout
+			t01.init({"build", "id_ref", "sizes", "decomposition"});
+			t02.init({"build", "id_ref", "cover", "decomposition"});
+			t03.init({"build", "id_ref", "cover", "relabel", "decomposition"});
+			if (relabel) { p02.init(); p03.init(); }
+			for (uint32_t i = 0; i < warmup; ++i) { nlognCD(w, false, nullptr); nCD(w, false, a, b, false, nullptr); if (relabel) nCD(w, false, a, b, true, nullptr); }
+			for (uint32_t i = 0; i < tests; ++i) {
+				nlognCD(w, check, &t01); // Perform O(n*log(n)) centroid decomposition
+				nCD(w, check, a, b, false, &t02, ((relabel)? &p02 : nullptr)); // Perform O(n) centroid decomposition
+				if (relabel) nCD(w, check, a, b, true, &t03, &p03); // Same, on the treelet layout
+			}
+			vector<tuple<string,string,struct phase_times*>> algs = {{"O(n*log(n))", "std", &t01}, {"O(n)", "lin", &t02}};
+			if (relabel) algs.pb({"O(n) [treelet layout]", "lin-treelet", &t03});
+			for (auto &[name, alg, t] : algs) {
+				bool lin = (t != &t01);
+				cout << name << " - " << n << " nodes" << ((lin)? " - A = " + to_string(a) + ", B = " + to_string(b) : "") << nl;
+				for (size_t j = 0; j < t->names.size(); ++j) {
+					struct stats s = summarize(t->runs[j]);
+					cout << " - " << t->names[j] << ": median " << printUs(s.median) << " - p95 " << printUs(s.p95) << " - min " << printUs(s.min) << nl;
+					results.pb({n, ((lin)? a : 0), ((lin)? b : 0), alg, t->names[j], s});
+				}
+			}
+			if (relabel) {
+				cout << "Cache misses of the decomposition, per run:" << nl;
+				printMisses("BFS layout", p02);
+				printMisses("treelet layout", p03);
+			}
+			cout << nl;
+		} catch (const char* err) {
+			cout << err << nl;
+			return -1;
+		}
+		if (!check) cerr << "Done for " << n << " nodes." << nl;
+		else cerr << nl;
+	}
+	// Machine-readable output
+	if (csv_path.compare("") != 0) {
+		ofstream out(csv_path);
+		out << "generator,k,seed,n,A,B,algorithm,phase,runs,min_ns,median_ns,p95_ns" << nl;
+		for (auto &r : results) out << g << "," << k << "," << seed << "," << r.n << "," << r.A << "," << r.B << "," << r.algorithm << "," << r.phase << "," << tests << "," << r.s.min << "," << r.s.median << "," << r.s.p95 << nl;
+	}
+	if (json_path.compare("") != 0) {
+		ofstream out(json_path);
+		out << "[" << nl;
+		for (size_t i = 0; i < results.size(); ++i) {
+			auto &r = results[i];
+			out << "  {\"generator\": \"" << g << "\", \"k\": " << k << ", \"seed\": " << seed << ", \"n\": " << r.n << ", \"A\": " << r.A << ", \"B\": " << r.B <<
+				", \"algorithm\": \"" << r.algorithm << "\", \"phase\": \"" << r.phase << "\", \"runs\": " << tests <<
+				", \"min_ns\": " << r.s.min << ", \"median_ns\": " << r.s.median << ", \"p95_ns\": " << r.s.p95 << "}" << ((i+1 < results.size())? "," : "") << nl;
+		}
+		out << "]" << nl;
+	}
+	return 0;
+}
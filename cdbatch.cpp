@@ -0,0 +1,130 @@
+#include "src/main.hpp"
+using namespace std;
+
+/*
+ * PERFORM CENTROID DECOMPOSITION OF MANY TREES IN O(n) TIME EACH
+ */
+
+// Global
+bool check = false;
+string manifest_path, stream_path, output_path;
+uint32_t A = 0, B = 1000, p = 1, batch = 0;
+
+// Print help
+void help() {
+	cout << "Usage: cdbatch [options]" << nl <<
+	"Options:" << nl <<
+	" -h        Print this help." << nl <<
+	" -i <arg>  Manifest: one input tree file per line, in BP or packed BP format." << nl <<
+	" -s <arg>  Stream: one input tree per line, in BP format (\"-\" for the standard input)." << nl <<
+	" -o <arg>  Output file: one centroid tree per line, in input order (\"-\" for the standard output)." << nl <<
+	" -A <arg>	Size of trelets for tree covering." << nl <<
+	" -B <arg>	Threshold for linear centroid decomposition." << nl <<
+	" -p <arg>	Number of threads [default: 1]." << nl <<
+	" -b <arg>	Number of trees read ahead and decomposed together [default: 1024 per thread]." << nl <<
+	" -c        Check correctness." << nl;
+	exit(0);
+}
+
+int main(int argc, char* argv[]) {
+	// Process command line options
+	int opt;
+	while ((opt = getopt(argc, argv, "hci:s:o:A:B:p:b:")) != -1) {
+		switch (opt) {
+			case 'h':
+				help();
+				break;
+			case 'c':
+				check = true;
+				break;
+			case 'i':
+				manifest_path = string(optarg);
+				break;
+			case 's':
+				stream_path = string(optarg);
+				break;
+			case 'o':
+				output_path = string(optarg);
+				break;
+			case 'A':
+				A = atoi(optarg);
+				break;
+			case 'B':
+				B = atoi(optarg);
+				break;
+			case 'p':
+				p = std::max(atoi(optarg), 1);
+				break;
+			case 'b':
+				batch = std::max(atoi(optarg), 1);
+				break;
+			default:
+				help();
+				return -1;
+		}
+	}
+	if ((manifest_path.compare("") == 0) == (stream_path.compare("") == 0)) { cout << "Error: exactly one of manifest and stream must be given." << nl << nl; help(); }
+	bool manifest = (manifest_path.compare("") != 0);
+	if (!batch) batch = 1024*p;
+	// Input and output
+	ifstream in_file;
+	if (manifest || stream_path.compare("-") != 0) {
+		in_file.open((manifest)? manifest_path : stream_path);
+		if (!in_file) { cout << "Error: cannot open input file." << nl; return -1; }
+	}
+	istream &in = ((in_file.is_open())? in_file : cin);
+	ofstream out_file;
+	if (output_path.compare("") != 0 && output_path.compare("-") != 0) out_file.open(output_path);
+	ostream *out = ((out_file.is_open())? &out_file : ((output_path.compare("-") == 0)? &cout : nullptr));
+	// Decompose the trees, a batch at a time
+	vector<cd_workspace<uint32_t>> ws(p); // One workspace per worker
+	vector<string> items(batch), results(batch);
+	uint64_t trees = 0, failed = 0, wrong = 0;
+	atomic<uint64_t> nodes(0);
+	chrono::high_resolution_clock::time_point t01 = getTime();
+	while (true) {
+		size_t k = 0;
+		while (k < batch && getline(in, items[k])) if (items[k].find_first_not_of(" \t\r") != string::npos) ++k; // Skip blank lines
+		if (k == 0) break;
+		ws_pool<size_t> pool(p);
+		for (size_t i = 0; i < k; ++i) pool.push(i % p, i);
+		pool.run([&](size_t i, uint32_t id) {
+			cd_workspace<uint32_t> &w = ws[id];
+			struct mapped_file f;
+			try {
+				if (manifest) {
+					items[i].erase(items[i].find_last_not_of(" \t\r") + 1); // Trailing whitespaces of the path
+					f = mapFile(items[i]);
+					const struct bp_header *h = packedTree(f);
+					if (h) w.decompose(*h, packedBits(f), A, B);
+					else w.decompose(f.data, f.len, A, B);
+					unmapFile(f);
+				} else w.decompose(items[i].data(), items[i].find_last_not_of(" \t\r") + 1, A, B);
+				nodes.fetch_add(sizeOfT(w.t));
+				results[i].clear();
+				if (check && !checkCorrectness(w.ct, w.id_ref, w.t.size())) results[i] = "Error: wrong centroid tree.";
+				else if (out) ctToString(w.ct, results[i]);
+			} catch (const char* err) {
+				unmapFile(f);
+				results[i] = string("Error: ") + err;
+			}
+		});
+		for (size_t i = 0; i < k; ++i) {
+			if (results[i].compare(0, 7, "Error: ") == 0) ++((results[i].compare("Error: wrong centroid tree.") == 0)? wrong : failed);
+			if (out) *out << results[i] << nl;
+		}
+		trees += k;
+	}
+	chrono::high_resolution_clock::time_point t02 = getTime();
+	if (out) out->flush();
+	// Report
+	double secs = chrono::duration_cast<chrono::duration<double>>(t02 - t01).count();
+	size_t mem = 0; for (auto &w : ws) mem += w.bytes();
+	ostream &log = ((out == &cout)? cerr : cout); // Keep the report apart from the centroid trees
+	log << "Trees: " << trees << " (" << nodes.load() << " nodes), failed: " << failed << nl;
+	if (check) log << "Correct: " << ((wrong == 0)? "true" : "false") << nl;
+	log << printTime("Total time", t01, t02) << nl;
+	log << "Throughput: " << uint64_t(trees / std::max(secs, 1e-9)) << " trees/s, " << uint64_t(nodes.load() / std::max(secs, 1e-9)) << " nodes/s" << nl;
+	log << "Workspaces: " << mem / 1024 << " KiB" << nl;
+	return ((failed || wrong)? -1 : 0);
+}
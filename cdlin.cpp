@@ -6,11 +6,11 @@ using namespace std;
  */
 
 // Global
-bool print_output = false, check = false;
-string input_path, tree;
-uint32_t n, A = 0, B = 1000;
-vector<uint32_t> t, t_cp, id_ref, t2;
-struct c_tree ct;
+bool print_output = false, check = false, map_input = false, oracle = false, hw = false, tune = false, relabel = false, parents = false, A_set = false, B_set = false, ooc = false, verify = true;
+string input_path, output_path, profile_path, snap_path, spill_dir = ".", format = "bp", tree;
+uint32_t n, A = 0, B = 1000, p = 1, w = 32, runs = 1;
+uint64_t budget = 0; // RAM budget of the out-of-core mode, in MiB
+vector<uint32_t> labels;
 
 // Print help
 void help() {
@@ -18,17 +18,220 @@ void help() {
 	"Options:" << nl <<
 	" -h        Print this help." << nl <<
 	" -i <arg>  Input tree [REQUIRED]." << nl <<
+	" -f <arg>  Input format. Options: bp, edges, parents [default: bp]." << nl <<
+	" -m        Memory-map the input tree." << nl <<
 	" -A <arg>	Size of trelets for tree covering." << nl <<
 	" -B <arg>	Threshold for linear centroid decomposition." << nl <<
+	" -l        Relabel T so that the nodes of each treelet are contiguous before the decomposition." << nl <<
+	" -t        Auto-tune A and B (explicit -A and -B take precedence)." << nl <<
+	" -P <arg>  Auto-tuning profile: reuse the values tuned in it, or tune them and save them there if it does not exist." << nl <<
+	" -s <arg>  Snapshot of T, id_ref and T2: load them from it (skipping the input, building and covering), or save them there after the covering if it does not exist." << nl <<
+	" -u        Load the snapshot without verifying the checksums of its sections [faster, but a corrupted snapshot goes undetected]." << nl <<
+	" -p <arg>	Number of threads [default: 1]." << nl <<
+	" -r <arg>	Number of decompositions of the same tree, restoring T in place in between [default: 1]." << nl <<
+	" -M <arg>  Out-of-core mode: RAM budget, in MiB, for the arrays of Theta(n) words [the others are spilled to disk; sequential, BP input only; pins glibc's mmap threshold to 1 MiB for the whole process]." << nl <<
+	" -D <arg>  Directory of the spill files of the out-of-core mode [default: .]." << nl <<
+	" -w <arg>	Width of node IDs, in bits. Options: 16, 32, 64 [default: 32]." << nl <<
 	" -o        Print output centroid tree." << nl <<
+	" -d        Output the centroid tree as parent and depth arrays, filled by the (sequential) decomposition." << nl <<
+	" -O <arg>  Write output centroid tree to a file, in binary format." << nl <<
+	" -a        Build the centroid-ancestor distance oracle [with -c, check its queries against BFS distances]." << nl <<
+	" -H        Report hardware performance counters per phase (timings only if unavailable)." << nl <<
 	" -c        Check correctness." << nl;
 	exit(0);
 }
 
+// Run the decomposition with node IDs of type 'I'
+// @return      exit status
+template<typename I>
+int run() {
+	vector<I> t, id_ref, t2;
+	basic_c_tree<I> ct;
+	basic_c_parents<I> cp; // Output with '-d'
+	struct cd_buffers<I> b;
+	struct treelet_layout<I> lay;
+	struct mapped_file f;
+	struct perf_report report, *perf = ((hw)? &report : nullptr); // Per-phase hardware counters
+	if (perf) perf->init();
+	bool load = (snap_path.compare("") != 0 && access(snap_path.c_str(), F_OK) == 0); // Load T, id_ref and T2 from the snapshot?
+	chrono::high_resolution_clock::time_point t01 = getTime();
+	if (load) { // Load the snapshot
+		cout << "Loading snapshot '" << snap_path << "' ..." << nl;
+		try {
+			perf_scope ps(perf, "Snapshot loading");
+			A = loadSnapshot(snap_path, t, id_ref, t2, labels, verify);
+		} catch (const char* err) {
+			cout << err << nl;
+			return -1;
+		}
+		cout << printTime(" - Snapshot loading", t01, getTime()) << " [A = " << ((A)? to_string(A) : "log(n)") << "]" << nl;
+	}
+	bool packed = (!load && isPackedTree(input_path)); // Packed BP format?
+	bool bp = (format.compare("bp") == 0);
+	if (!load && !map_input && !packed && bp) { ifstream in(input_path); in >> tree; in.close(); f.data = tree.data(); f.len = tree.length(); }
+	// Build T
+	if (!load) cout << "Building internal representation ..." << nl;
+	if (!load) try {
+		if (map_input || packed || !bp) f = mapFile(input_path); // Zero-copy input
+		perf_scope ps(perf, "Tree building");
+		if (format.compare("edges") == 0) t = loadEdges<I>(f, labels, p);
+		else if (format.compare("parents") == 0) t = loadParents<I>(f, labels, p);
+		else if (packed) t = buildTree<I>(*packedTree(f), packedBits(f));
+		else t = ((p > 1)? buildTreeParallel<I>(f.data, f.len, p) : buildTree<I>(f.data, f.len));
+	} catch (const char* err) {
+		cout << err << nl;
+		return -1;
+	}
+	unmapFile(f);
+	if (tune || profile_path.compare("") != 0) { // Auto-tuning [a loaded snapshot can only reuse a profile]
+		struct cd_profile prof;
+		try {
+			if (profile_path.compare("") != 0 && loadProfile(profile_path, prof)) cout << "Using tuned parameters from '" << profile_path << "'" << nl;
+			else if (load) { cout << "Auto-tuning skipped: it needs the input tree." << nl; prof.A = A; prof.B = B; }
+			else {
+				chrono::high_resolution_clock::time_point t01 = getTime();
+				prof = tuneParameters(t, p);
+				cout << printTime("Auto-tuning", t01, getTime()) << nl;
+				if (profile_path.compare("") != 0) saveProfile(profile_path, prof);
+			}
+		} catch (const char* err) {
+			cout << err << nl;
+			return -1;
+		}
+		if (!A_set && !load) A = prof.A; // T2 of a loaded snapshot is already built
+		if (!B_set) B = prof.B;
+		cout << "A = " << A << ", B = " << B << nl;
+	}
+	cout << "Partial times:" << nl;
+	// Build T reference bitvector
+	if (!load) {
+		t01 = getTime();
+		{ perf_scope ps(perf, "T reference bitvector building"); id_ref = buildIdRef(t); }
+		cout << printTime(" - T reference bitvector building", t01, getTime()) << nl;
+	}
+	for (uint32_t r = 0; r < runs; ++r) {
+		if (runs > 1) cout << "Run " << r+1 << "/" << runs << ":" << nl;
+		if (r > 0) { // Restore T for the next run [instead of keeping a copy of it]
+			t01 = getTime();
+			restoreTree(t, id_ref, p);
+			cout << printTime(" - T restoring", t01, getTime()) << nl;
+		}
+		// Tree covering
+		chrono::high_resolution_clock::time_point t02 = getTime();
+		if (!load || r > 0) {
+			try {
+				perf_scope ps(perf, "Tree covering and partial sizes");
+				t2 = cover(t, id_ref, A, p);
+			} catch (const char* err) {
+				cout << err << nl;
+				return -1;
+			}
+			cout << printTime(" - Tree covering and partial sizes", t02, getTime()) << nl;
+		}
+		if (!load && r == 0 && snap_path.compare("") != 0) { // Save the snapshot
+			t02 = getTime();
+			try {
+				ofstream out(snap_path, ios::binary);
+				writeSnapshot(out, t, id_ref, t2, A, labels);
+			} catch (const char* err) {
+				cout << err << nl;
+				return -1;
+			}
+			cout << printTime(" - Snapshot saving", t02, getTime()) << nl;
+		}
+		if (relabel) { // Treelet-contiguous layout
+			t02 = getTime();
+			{ perf_scope ps(perf, "Treelet relabeling"); lay = relabelTree(t, t2); }
+			cout << printTime(" - Treelet relabeling", t02, getTime()) << nl;
+		}
+		if (r == 0) cout << printTime(" - Total structure building", t01, getTime()) << nl; // Total time
+		// Perform centroid decomposition: O(n)
+		t01 = getTime();
+		{
+			perf_scope ps(perf, "Linear centroid decomposition");
+			if (parents) centroidDecomposition(t, t2, cp, b, B, perf);
+			else ct = ((p > 1)? parallelCentroidDecomposition(t, t2, B, p) : centroidDecomposition(t, t2, B, perf));
+		}
+		cout << printTime(" - Linear centroid decomposition", t01, getTime()) << nl;
+		if (relabel) { // Back to the IDs of the BFS layout
+			t01 = getTime();
+			lay.restoreIds(ct.ids, t, p);
+			cout << printTime(" - Treelet IDs restoring", t01, getTime()) << nl;
+		}
+	}
+	if (oracle) { // Centroid-ancestor distance oracle
+		t01 = getTime();
+		ca_oracle<I> o; o.init(ct, id_ref, t.size(), p);
+		cout << printTime(" - Distance oracle building", t01, getTime()) << " [" << o.anc.size() << " entries]" << nl;
+		if (check) cout << "Oracle check: " << ((checkOracle(o, p))? "true" : "false") << nl; // Queries against BFS distances
+	}
+	if(check) cout << "Correct: " << ((((parents)? checkCorrectness(cp, id_ref, t.size()) : checkCorrectness(ct, id_ref, t.size())))? "true" : "false") << nl; // Correctness check
+	if (print_output && parents) cout << "Output: " << ((labels.empty())? cpToString(cp) : cpToString(cp, labels)) << nl; // Print output
+	else if (print_output) cout << "Output: " << ((labels.empty())? ctToString(ct) : ctToString(ct, id_ref, labels)) << nl;
+	if (output_path.compare("") != 0) { ofstream out(output_path, ios::binary); ((labels.empty())? writeCt(out, ct) : writeCt(out, ct, id_ref, labels)); } // Write output
+	if (check && output_path.compare("") != 0) cout << "Output file check: " << ((((labels.empty())? checkCtFile(output_path, ct) : checkCtFile(output_path, ct, id_ref, labels)))? "true" : "false") << nl; // Read the output back and navigate it
+	if (perf) cout << perf->toString();
+	return 0;
+}
+
+// Run the out-of-core decomposition with node IDs of type 'I'
+// @return      exit status
+template<typename I>
+int runOutOfCore() {
+	ooc_workspace<I> ws;
+	struct mapped_file f;
+	struct perf_report report, *perf = ((hw)? &report : nullptr); // Per-phase hardware counters
+	if (perf) perf->init();
+	chrono::high_resolution_clock::time_point t01, t02;
+	// Build T
+	cout << "Building internal representation ..." << nl;
+	try {
+		ws.sp.init(spill_dir, budget << 20);
+		f = mapFile(input_path); // Zero-copy input
+		const struct bp_header *h = packedTree(f);
+		ws.reserve(((h)? h->n : f.len/2), A);
+		perf_scope ps(perf, "Tree building");
+		if (h) buildTree(*h, packedBits(f), ws.t);
+		else buildTree(f.data, f.len, ws.t);
+	} catch (const char* err) {
+		unmapFile(f);
+		cout << err << nl;
+		return -1;
+	}
+	unmapFile(f);
+	cout << "RAM budget: " << budget << " MiB [in RAM: " << (ws.sp.in_ram >> 10) << " KiB, spilled to '" << spill_dir << "': " << (ws.sp.on_disk >> 10) << " KiB" << ((ws.sp.spilled.empty())? "" : " (" + ws.sp.spilled + ")") << "]" << nl;
+	cout << "Partial times:" << nl;
+	// Build T reference bitvector
+	t01 = getTime();
+	{ perf_scope ps(perf, "T reference bitvector building"); buildIdRef(ws.t, ws.id_ref); }
+	cout << printTime(" - T reference bitvector building", t01, getTime()) << nl;
+	// Tree covering
+	t02 = getTime();
+	try {
+		perf_scope ps(perf, "Tree covering and partial sizes");
+		cover(ws.t, ws.id_ref, ws.t2, ws.b.cs, A);
+	} catch (const char* err) {
+		cout << err << nl;
+		return -1;
+	}
+	cout << printTime(" - Tree covering and partial sizes", t02, getTime()) << nl;
+	cout << printTime(" - Total structure building", t01, getTime()) << nl;
+	// Perform centroid decomposition: O(n)
+	t01 = getTime();
+	{ perf_scope ps(perf, "Linear centroid decomposition"); oocCentroidDecomposition(ws.t, ws.t2, ws.ct, ws.b, B); }
+	cout << printTime(" - Linear centroid decomposition", t01, getTime()) << nl;
+	if (check) cout << "Correct: " << ((checkCorrectness(ws.ct, ws.id_ref, ws.t.size()))? "true" : "false") << nl; // Correctness check
+	if (print_output) cout << "Output: " << ctToString(ws.ct) << nl; // Print output
+	if (output_path.compare("") != 0) { ofstream out(output_path, ios::binary); writeCt(out, ws.ct); } // Write output [read back from the spill files in order]
+	if (check && output_path.compare("") != 0) cout << "Output file check: " << ((checkCtFile(output_path, ws.ct))? "true" : "false") << nl; // Read the output back and navigate it
+	if (perf) cout << perf->toString();
+	return 0;
+}
+
 int main(int argc, char* argv[]) {
 	// Process command line options
 	int opt;
-	while ((opt = getopt(argc, argv, "hoci:A:B:")) != -1) {
+	while ((opt = getopt(argc, argv, "hoacdHmltuP:s:i:O:f:A:B:p:r:w:M:D:")) != -1) {
 		switch (opt) {
 			case 'h':
 				help();
@@ -36,17 +239,67 @@ int main(int argc, char* argv[]) {
 			case 'o':
 				print_output = true;
 				break;
+			case 'a':
+				oracle = true;
+				break;
 			case 'c':
 				check = true;
 				break;
+			case 'd':
+				parents = true;
+				break;
+			case 'H':
+				hw = true;
+				break;
+			case 'm':
+				map_input = true;
+				break;
+			case 'l':
+				relabel = true;
+				break;
+			case 't':
+				tune = true;
+				break;
+			case 'u':
+				verify = false;
+				break;
+			case 'P':
+				profile_path = string(optarg);
+				break;
+			case 's':
+				snap_path = string(optarg);
+				break;
+			case 'O':
+				output_path = string(optarg);
+				break;
 			case 'i':
 				input_path = string(optarg);
 				break;
+			case 'f':
+				if (strcmp("bp", optarg) == 0 || strcmp("edges", optarg) == 0 || strcmp("parents", optarg) == 0) format = optarg;
+				else help();
+				break;
 			case 'A':
-				A = atoi(optarg);
+				A = atoi(optarg); A_set = true;
 				break;
 			case 'B':
-				B = atoi(optarg);
+				B = atoi(optarg); B_set = true;
+				break;
+			case 'p':
+				p = atoi(optarg);
+				break;
+			case 'r':
+				runs = std::max(atoi(optarg), 1);
+				break;
+			case 'M':
+				budget = strtoull(optarg, nullptr, 10); ooc = true;
+				break;
+			case 'D':
+				spill_dir = string(optarg);
+				break;
+			case 'w':
+				w = atoi(optarg);
+				if (w != 16 && w != 32 && w != 64) help();
 				break;
 			default:
 				help();
@@ -54,39 +307,11 @@ int main(int argc, char* argv[]) {
 		}
 	}
 	// Centroid decomposition
-	if (input_path.compare("") == 0) { cout << "Error: no input file." << nl << nl; help(); } // If no input is given
-	cout << "Processing file '" << input_path << "'..." << nl;
-	ifstream in(input_path); in >> tree; in.close();
-	// Build T
-	cout << "Building internal representation ..." << nl;
-	try {
-		t = buildTree(tree);
-	} catch (const char* err) {
-		cout << err << nl;
-		return -1;
-	}
-	cout << "Partial times:" << nl;
-	// Build T reference bitvector
-	chrono::high_resolution_clock::time_point t01 = getTime();
-	id_ref = buildIdRef(t);
-	cout << printTime(" - T reference bitvector building", t01, getTime()) << nl;
-	// Tree covering
-	chrono::high_resolution_clock::time_point t02 = getTime();
-	try {
-		t2 = cover(t, id_ref, A);
-	} catch (const char* err) {
-		cout << err << nl;
-		return -1;
-	}
-	cout << printTime(" - Tree covering and partial sizes", t02, getTime()) << nl;
-	cout << printTime(" - Total structure building", t01, getTime()) << nl; // Total time
-	// Copy structures
-	if (check) t_cp = t;
-	// Perform centroid decomposition: O(n)
-	t01 = getTime();
-	ct = centroidDecomposition(t, t2, B);
-	cout << printTime(" - Linear centroid decomposition", t01, getTime()) << nl;
-	if(check) cout << "Correct: " << ((checkCorrectness(t_cp, ct))? "true" : "false") << nl; // Correctness check
-	if (print_output) cout << "Output: " << ctToString(ct) << nl; // Print output
-	return 0;
-}
\ No newline at end of file
+	if (input_path.compare("") == 0 && (snap_path.compare("") == 0 || access(snap_path.c_str(), F_OK) != 0)) { cout << "Error: no input file." << nl << nl; help(); } // If no input is given
+	if (parents && (relabel || oracle || output_path.compare("") != 0)) { cout << "Error: -d cannot be combined with -l, -a or -O." << nl << nl; help(); }
+	if (ooc && (parents || relabel || oracle || tune || runs > 1 || format.compare("bp") != 0 || profile_path.compare("") != 0 || snap_path.compare("") != 0)) { cout << "Error: -M only takes BP input, and cannot be combined with -d, -l, -a, -t, -P, -s or -r." << nl << nl; help(); }
+	if (ooc && input_path.compare("") == 0) { cout << "Error: no input file." << nl << nl; help(); }
+	cout << "Processing file '" << ((input_path.compare("") != 0)? input_path : snap_path) << "'..." << nl;
+	if (ooc) return ((w == 16)? runOutOfCore<uint16_t>() : ((w == 64)? runOutOfCore<uint64_t>() : runOutOfCore<uint32_t>()));
+	return ((w == 16)? run<uint16_t>() : ((w == 64)? run<uint64_t>() : run<uint32_t>()));
+}
@@ -6,10 +6,10 @@ using namespace std;
  */
 
 // Global
-bool print_output = false, check = false;
-string input_path, tree;
-vector<uint32_t> t, t_cp, id_ref;
-struct c_tree ct;
+bool print_output = false, check = false, map_input = false, oracle = false, hw = false, parents = false;
+string input_path, output_path, format = "bp", tree;
+uint32_t w = 32, runs = 1;
+vector<uint32_t> labels;
 
 // Print help
 void help() {
@@ -17,15 +17,91 @@ void help() {
 	"Options:" << nl <<
 	" -h        Print this help." << nl <<
 	" -i <arg>  Input tree [REQUIRED]." << nl <<
+	" -f <arg>  Input format. Options: bp, edges, parents [default: bp]." << nl <<
+	" -m        Memory-map the input tree." << nl <<
+	" -r <arg>	Number of decompositions of the same tree, restoring T in place in between [default: 1]." << nl <<
+	" -w <arg>	Width of node IDs, in bits. Options: 16, 32, 64 [default: 32]." << nl <<
 	" -o        Print output centroid tree." << nl <<
+	" -d        Output the centroid tree as parent and depth arrays, filled by the decomposition." << nl <<
+	" -O <arg>  Write output centroid tree to a file, in binary format." << nl <<
+	" -a        Build the centroid-ancestor distance oracle [with -c, check its queries against BFS distances]." << nl <<
+	" -H        Report hardware performance counters per phase (timings only if unavailable)." << nl <<
 	" -c        Check correctness." << nl;
 	exit(0);
 }
 
+// Run the decomposition with node IDs of type 'I'
+// @return      exit status
+template<typename I>
+int run() {
+	vector<I> t, id_ref;
+	basic_c_tree<I> ct;
+	basic_c_parents<I> cp; // Output with '-d'
+	struct mapped_file f;
+	struct perf_report report, *perf = ((hw)? &report : nullptr); // Per-phase hardware counters
+	if (perf) perf->init();
+	bool packed = isPackedTree(input_path); // Packed BP format?
+	bool bp = (format.compare("bp") == 0);
+	if (!map_input && !packed && bp) { ifstream in(input_path); in >> tree; in.close(); f.data = tree.data(); f.len = tree.length(); }
+	// Build T
+	cout << "Building internal representation ..." << nl;
+	try {
+		if (map_input || packed || !bp) f = mapFile(input_path); // Zero-copy input
+		perf_scope ps(perf, "Tree building");
+		if (format.compare("edges") == 0) t = loadEdges<I>(f, labels, 1);
+		else if (format.compare("parents") == 0) t = loadParents<I>(f, labels, 1);
+		else if (packed) t = buildTree<I>(*packedTree(f), packedBits(f));
+		else t = buildTree<I>(f.data, f.len);
+	} catch (const char* err) {
+		cout << err << nl;
+		return -1;
+	}
+	unmapFile(f);
+	cout << "Partial times:" << nl;
+	// Build T reference bitvector
+	chrono::high_resolution_clock::time_point t01 = getTime();
+	{ perf_scope ps(perf, "T reference bitvector building"); id_ref = buildIdRef(t); }
+	cout << printTime(" - T reference bitvector building", t01, getTime()) << nl;
+	for (uint32_t r = 0; r < runs; ++r) {
+		if (runs > 1) cout << "Run " << r+1 << "/" << runs << ":" << nl;
+		if (r > 0) { // Restore T for the next run [instead of keeping a copy of it]
+			t01 = getTime();
+			restoreTree(t, id_ref);
+			cout << printTime(" - T restoring", t01, getTime()) << nl;
+		}
+		// Compute partial sizes on T
+		chrono::high_resolution_clock::time_point t02 = getTime();
+		{ perf_scope ps(perf, "Computing partial sizes"); computeSizes(t, id_ref); }
+		cout << printTime(" - Computing partial sizes", t02, getTime()) << nl;
+		if (r == 0) cout << printTime(" - Total structure building", t01, getTime()) << nl; // Total time
+		// Perform centroid decomposition: O(n*log(n))
+		t01 = getTime();
+		{
+			perf_scope ps(perf, "Standard centroid decomposition");
+			if (parents) stdCentroidDecomposition(t, cp);
+			else ct = stdCentroidDecomposition<I>(t);
+		}
+		cout << printTime(" - Standard centroid decomposition", t01, getTime()) << nl;
+	}
+	if (oracle) { // Centroid-ancestor distance oracle
+		t01 = getTime();
+		ca_oracle<I> o; o.init(ct, id_ref, t.size(), 1);
+		cout << printTime(" - Distance oracle building", t01, getTime()) << " [" << o.anc.size() << " entries]" << nl;
+		if (check) cout << "Oracle check: " << ((checkOracle(o, 1))? "true" : "false") << nl; // Queries against BFS distances
+	}
+	if(check) cout << "Correct: " << ((((parents)? checkCorrectness(cp, id_ref, t.size()) : checkCorrectness(ct, id_ref, t.size())))? "true" : "false") << nl; // Correctness check
+	if (print_output && parents) cout << "Output: " << ((labels.empty())? cpToString(cp) : cpToString(cp, labels)) << nl; // Print output
+	else if (print_output) cout << "Output: " << ((labels.empty())? ctToString(ct) : ctToString(ct, id_ref, labels)) << nl;
+	if (output_path.compare("") != 0) { ofstream out(output_path, ios::binary); ((labels.empty())? writeCt(out, ct) : writeCt(out, ct, id_ref, labels)); } // Write output
+	if (check && output_path.compare("") != 0) cout << "Output file check: " << ((((labels.empty())? checkCtFile(output_path, ct) : checkCtFile(output_path, ct, id_ref, labels)))? "true" : "false") << nl; // Read the output back and navigate it
+	if (perf) cout << perf->toString();
+	return 0;
+}
+
 int main(int argc, char* argv[]) {
 	// Process command line options
 	int opt;
-	while ((opt = getopt(argc, argv, "hoci:")) != -1) {
+	while ((opt = getopt(argc, argv, "hoacdHmi:O:f:r:w:")) != -1) {
 		switch (opt) {
 			case 'h':
 				help();
@@ -33,12 +109,38 @@ int main(int argc, char* argv[]) {
 			case 'o':
 				print_output = true;
 				break;
+			case 'a':
+				oracle = true;
+				break;
 			case 'c':
 				check = true;
 				break;
+			case 'd':
+				parents = true;
+				break;
+			case 'H':
+				hw = true;
+				break;
+			case 'm':
+				map_input = true;
+				break;
+			case 'O':
+				output_path = string(optarg);
+				break;
 			case 'i':
 				input_path = string(optarg);
 				break;
+			case 'f':
+				if (strcmp("bp", optarg) == 0 || strcmp("edges", optarg) == 0 || strcmp("parents", optarg) == 0) format = optarg;
+				else help();
+				break;
+			case 'r':
+				runs = std::max(atoi(optarg), 1);
+				break;
+			case 'w':
+				w = atoi(optarg);
+				if (w != 16 && w != 32 && w != 64) help();
+				break;
 			default:
 				help();
 				return -1;
@@ -46,33 +148,7 @@ int main(int argc, char* argv[]) {
 	}
 	// Centroid decomposition
 	if (input_path.compare("") == 0) { cout << "Error: no input file." << nl << nl; help(); } // If no input is given
+	if (parents && (oracle || output_path.compare("") != 0)) { cout << "Error: -d cannot be combined with -a or -O." << nl << nl; help(); }
 	cout << "Processing file '" << input_path << "'..." << nl;
-	ifstream in(input_path); in >> tree; in.close();
-	// Build T
-	cout << "Building internal representation ..." << nl;
-	try {
-		t = buildTree(tree);
-	} catch (const char* err) {
-		cout << err << nl;
-		return -1;
-	}
-	cout << "Partial times:" << nl;
-	// Build T reference bitvector
-	chrono::high_resolution_clock::time_point t01 = getTime();
-	id_ref = buildIdRef(t);
-	cout << printTime(" - T reference bitvector building", t01, getTime()) << nl;
-	// Compute partial sizes on T
-	chrono::high_resolution_clock::time_point t02 = getTime();
-	computeSizes(t, id_ref);
-	cout << printTime(" - Computing partial sizes", t02, getTime()) << nl;
-	cout << printTime(" - Total structure building", t01, getTime()) << nl; // Total time
-	// Copy structures
-	if (check) t_cp = t;
-	// Perform centroid decomposition: O(n*log(n))
-	t01 = getTime();
-	ct = stdCentroidDecomposition(t);
-	cout << printTime(" - Standard centroid decomposition", t01, getTime()) << nl;
-	if(check) cout << "Correct: " << ((checkCorrectness(t_cp, ct))? "true" : "false") << nl; // Correctness check
-	if (print_output) cout << "Output: " << ctToString(ct) << nl; // Print output
-	return 0;
-}
\ No newline at end of file
+	return ((w == 16)? run<uint16_t>() : ((w == 64)? run<uint64_t>() : run<uint32_t>()));
+}
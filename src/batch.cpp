@@ -0,0 +1,62 @@
+#ifndef BATCH
+#define BATCH
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * REUSABLE WORKSPACE FOR MANY TREES
+ */
+
+// Workspace of the linear centroid decomposition of many trees, one at a time
+// Every structure is rebuilt in place, so the containers grow up to the biggest tree seen (high-water mark) and then no more memory is allocated.
+template<typename I = uint32_t>
+struct cd_workspace {
+
+    vector<I> t, id_ref, t2; // Structures of the last tree
+    basic_c_tree<I> ct; // Centroid tree of the last tree
+    struct cd_buffers<I> b; // Scratch space
+
+    // Decompose a tree given in BP representation
+    // @param tree          BP representation of tree
+    // @param len           length of the BP representation
+    // @param A             minimum size of cover elements - log(n) if not given
+    // @param B             threshold for standard centroid decomposition - (log(n))^3 if not given
+    void decompose(const char *tree, const size_t len, const uint32_t A = 0, const uint64_t B = 0) { // Complexity: O(n)
+        buildTree(tree, len, t);
+        run(A, B);
+    }
+
+    // Decompose a tree given in packed BP representation
+    // @param h             header of the packed tree
+    // @param bits          packed BP representation of tree
+    // @param A             minimum size of cover elements - log(n) if not given
+    // @param B             threshold for standard centroid decomposition - (log(n))^3 if not given
+    void decompose(const struct bp_header &h, const uint64_t *bits, const uint32_t A = 0, const uint64_t B = 0) { // Complexity: O(n)
+        buildTree(h, bits, t);
+        run(A, B);
+    }
+
+    // Decompose the tree already built on T
+    // @param A             minimum size of cover elements - log(n) if not given
+    // @param B             threshold for standard centroid decomposition - (log(n))^3 if not given
+    void run(const uint32_t A, const uint64_t B) { // Complexity: O(n)
+        buildIdRef(t, id_ref);
+        cover(t, id_ref, t2, b.cs, A);
+        centroidDecomposition(t, t2, ct, b, B);
+    }
+
+    // Get the memory held by the workspace
+    // @return              size of the containers, in bytes
+    size_t bytes() const { // Complexity: O(1)
+        auto c = [](const auto &v) { return v.capacity() * sizeof(v[0]); };
+        return c(t) + c(id_ref) + c(t2) + c(ct.shape.w) + c(ct.ids) +
+            c(b.cs.x) + c(b.cs.q) + c(b.cs.aux) + c(b.cs.cnt) + c(b.s.s) +
+            c(b.sc.order) + c(b.sc.children) + c(b.sc.deltas) + c(b.sc.c_ref) + c(b.sc.c) + c(b.sc.cd) + c(b.sc.comps) + c(b.sc.head) + c(b.sc.next) +
+            c(b.ss.l16.v) + c(b.ss.l16.kids) + c(b.ss.l16.csize) + c(b.ss.l16.id) + c(b.ss.l16.s) +
+            c(b.ss.l32.v) + c(b.ss.l32.kids) + c(b.ss.l32.csize) + c(b.ss.l32.id) + c(b.ss.l32.s);
+    }
+
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef BP
+#define BP
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * SUCCINCT CENTROID TREE NAVIGATION
+ */
+
+// Rank, select and navigation support on a balanced parenthesis bit vector ("(" is 0, ")" is 1)
+// Nodes are identified by the position of their "(": the k-th node in preorder is 'select0(k)', and its ID is 'ct.ids[k]'.
+// Navigation relies on a range min tree over the excess of the words: E(i) is the number of "(" minus the number of ")" in [0,i], and E(-1) = 0.
+struct bp_support {
+
+    static constexpr size_t npos = SIZE_MAX; // Not found
+    static constexpr size_t sample = 512; // Sampling rate of 'select'
+
+    const bitvector *b = nullptr; // Parentheses
+    vector<uint64_t> r; // Number of ")" before each word (plus the total, as last)
+    vector<uint64_t> s0, s1; // Word holding every 'sample'-th "(" and ")"
+    vector<int64_t> m; // Range min tree on the excess: the min of E over word w is m[P+w], and each internal node holds the min of its children
+    size_t P = 1; // Number of leaves of the range min tree (power of 2)
+
+    // Build the support structures
+    // @param bv            balanced parenthesis bit vector
+    void init(const bitvector &bv) { // Complexity: O(n)
+        b = &bv;
+        size_t words = bv.w.size();
+        r = vector<uint64_t>(words+1, 0);
+        s0.clear(); s1.clear();
+        P = 1; while (P < words) P *= 2;
+        m = vector<int64_t>(2*P, INT64_MAX);
+        int64_t e = 0;
+        uint64_t c0 = 0, c1 = 0;
+        for (size_t w = 0; w < words; ++w) {
+            r[w+1] = r[w] + __builtin_popcountll(bv.w[w]);
+            for (size_t i = 64*w; i < std::min(64*(w+1), bv.size()); ++i) {
+                if (bv[i]) { if (c1++ % sample == 0) s1.pb(w); --e; }
+                else { if (c0++ % sample == 0) s0.pb(w); ++e; }
+                m[P+w] = std::min(m[P+w], e);
+            }
+        }
+        for (size_t v = P-1; v > 0; --v) m[v] = std::min(m[2*v], m[2*v+1]);
+    }
+
+    // Number of ")" in [0,i)
+    // @param i             position
+    // @return              rank of ")"
+    size_t rank1(const size_t i) const { // Complexity: O(1)
+        return r[i/64] + ((i%64)? __builtin_popcountll(b->w[i/64] << (64 - i%64)) : 0);
+    }
+
+    // Number of "(" in [0,i)
+    // @param i             position
+    // @return              rank of "("
+    size_t rank0(const size_t i) const { // Complexity: O(1)
+        return i - rank1(i);
+    }
+
+    // Position of the k-th (0-based) ")"
+    // @param k             rank of the ")"
+    // @return              position of the ")"
+    size_t select1(const size_t k) const { // Complexity: O(log(n)) [binary search on the words between two samples]
+        size_t lo = s1[k/sample], hi = ((k/sample+1 < s1.size())? s1[k/sample+1] : r.size()-2); // The word holding the ")" is in [lo,hi]
+        while (lo < hi) { size_t mid = (lo+hi+1) / 2; if (r[mid] <= k) lo = mid; else hi = mid-1; } // Last word with at most k ")" before it
+        return 64*lo + selectInWord(b->w[lo], k - r[lo]);
+    }
+
+    // Position of the k-th (0-based) "("
+    // @param k             rank of the "("
+    // @return              position of the "("
+    size_t select0(const size_t k) const { // Complexity: O(log(n)) [binary search on the words between two samples]
+        size_t lo = s0[k/sample], hi = ((k/sample+1 < s0.size())? s0[k/sample+1] : r.size()-2); // The word holding the "(" is in [lo,hi]
+        while (lo < hi) { size_t mid = (lo+hi+1) / 2; if (64*mid - r[mid] <= k) lo = mid; else hi = mid-1; } // Last word with at most k "(" before it
+        return 64*lo + selectInWord(~b->w[lo], k - (64*lo - r[lo]));
+    }
+
+    // Excess at a position
+    // @param i             position
+    // @return              E(i)
+    int64_t excess(const size_t i) const { // Complexity: O(1)
+        return int64_t(i+1) - 2*int64_t(rank1(i+1));
+    }
+
+    // First position after 'i' with excess at most 'd'
+    // @param i             starting position
+    // @param d             target excess
+    // @return              smallest j > i such that E(j) <= d, npos if none
+    size_t fwdSearch(const size_t i, const int64_t d) const { // Complexity: O(log(j-i))
+        size_t j = i + 1;
+        int64_t e = excess(i);
+        for (; j < b->size() && j%64 != 0; ++j) { // Rest of the current word
+            e += delta(j);
+            if (e <= d) return j;
+        }
+        if (j >= b->size()) return npos;
+        size_t v = P + j/64;
+        if (m[v] > d) { // Climb up to the first range to the right holding the target, then go down to its leftmost word
+            for (; v > 1 && ((v&1) || m[v+1] > d); v /= 2);
+            if (v <= 1) return npos;
+            for (++v; v < P; v = ((m[2*v] <= d)? 2*v : 2*v+1));
+        }
+        j = 64*(v-P); e = int64_t(j) - 2*int64_t(r[v-P]);
+        for (;; ++j) {
+            e += delta(j);
+            if (e <= d) return j;
+        }
+    }
+
+    // Last position up to 'j' preceded by excess at most 'd'
+    // @param j             starting position
+    // @param d             target excess
+    // @return              greatest p <= j such that E(p-1) <= d, npos if none
+    size_t bwdSearch(const size_t j, const int64_t d) const { // Complexity: O(log(j-p))
+        if (j == 0) return ((d >= 0)? 0 : npos);
+        size_t k = j - 1;
+        int64_t e = excess(k);
+        for (;; e -= delta(k), --k) { // Rest of the current word
+            if (e <= d) return k+1;
+            if (k%64 == 0) break;
+        }
+        size_t v = P + k/64;
+        for (; v > 1 && (!(v&1) || m[v-1] > d); v /= 2); // Climb up to the first range to the left holding the target, then go down to its rightmost word
+        if (v <= 1) return ((d >= 0)? 0 : npos); // E(-1) = 0
+        for (--v; v < P; v = ((m[2*v+1] <= d)? 2*v+1 : 2*v));
+        k = 64*(v-P) + 63; e = excess(k);
+        for (;; e -= delta(k), --k) if (e <= d) return k+1;
+    }
+
+    // Matching ")" of a "("
+    // @param i             position of the "("
+    // @return              position of the ")"
+    size_t findClose(const size_t i) const { // Complexity: O(log(n))
+        return fwdSearch(i, excess(i)-1);
+    }
+
+    // Matching "(" of a ")"
+    // @param j             position of the ")"
+    // @return              position of the "("
+    size_t findOpen(const size_t j) const { // Complexity: O(log(n))
+        return bwdSearch(j, excess(j));
+    }
+
+    // Parent of a node
+    // @param i             node (position of its "(")
+    // @return              parent node, npos if 'i' is the root
+    size_t parent(const size_t i) const { // Complexity: O(log(n))
+        int64_t d = excess(i) - 2;
+        return ((d < 0)? npos : bwdSearch(i, d));
+    }
+
+    // First child of a node
+    // @param i             node (position of its "(")
+    // @return              first child, npos if 'i' is a leaf
+    size_t firstChild(const size_t i) const { // Complexity: O(1)
+        return (((*b)[i+1])? npos : i+1);
+    }
+
+    // Next sibling of a node
+    // @param i             node (position of its "(")
+    // @return              next sibling, npos if 'i' is the last child
+    size_t nextSibling(const size_t i) const { // Complexity: O(log(n))
+        size_t j = findClose(i) + 1;
+        return ((j < b->size() && !(*b)[j])? j : npos);
+    }
+
+    // Number of nodes in the subtree of a node
+    // @param i             node (position of its "(")
+    // @return              size of the subtree
+    size_t subtreeSize(const size_t i) const { // Complexity: O(log(n))
+        return (findClose(i) - i + 1) / 2;
+    }
+
+    // Depth of a node [the root has depth 0]
+    // @param i             node (position of its "(")
+    // @return              depth of the node
+    size_t depth(const size_t i) const { // Complexity: O(1)
+        return excess(i) - 1;
+    }
+
+    // Preorder rank of a node [i.e. its position in 'ct.ids']
+    // @param i             node (position of its "(")
+    // @return              preorder rank
+    size_t preorder(const size_t i) const { // Complexity: O(1)
+        return rank0(i);
+    }
+
+    // Node with a given preorder rank
+    // @param k             preorder rank
+    // @return              node (position of its "(")
+    size_t node(const size_t k) const { // Complexity: O(log(n))
+        return select0(k);
+    }
+
+    private:
+
+    // Change of excess at a position
+    // @param i             position
+    // @return              +1 for "(", -1 for ")"
+    int64_t delta(const size_t i) const {
+        return (((*b)[i])? -1 : 1);
+    }
+
+    // Position of the k-th (0-based) set bit of a word
+    // @param w             word
+    // @param k             rank of the bit
+    // @return              position of the bit in the word
+    static size_t selectInWord(uint64_t w, size_t k) {
+#ifdef __BMI2__
+        return __builtin_ctzll(_pdep_u64(1ull << k, w));
+#else
+        for (; k > 0; --k) w &= w - 1; // Clear the lowest k set bits
+        return __builtin_ctzll(w);
+#endif
+    }
+
+};
+
+// Check the support structures of a balanced parenthesis bit vector against a scan of its parentheses
+// @param bv        balanced parenthesis bit vector ("(" is 0, ")" is 1)
+// @return          true if every rank, select and navigation query matches the scan, false otherwise
+inline bool checkNavigation(const bitvector &bv) { // Complexity: O(n*log(n))
+    struct bp_support s; s.init(bv);
+    size_t N = bv.size(), npos = bp_support::npos;
+    vector<size_t> close(N, npos), st; // Matching ")" of each "(", and the open nodes
+    for (size_t i = 0, k1 = 0; i < N; ++i) { // Scan the parentheses, checking the queries on the ")"
+        if (!bv[i]) { st.pb(i); continue; }
+        if (st.empty() || s.rank1(i) != k1 || s.select1(k1) != i) return false;
+        close[st.back()] = i; st.pop_back(); ++k1;
+    }
+    if (!st.empty()) return false;
+    for (size_t i = 0, k0 = 0; i < N; ++i) { // Check the queries on the "("
+        if (bv[i]) { st.pop_back(); continue; }
+        size_t c = close[i];
+        if (s.rank0(i) != k0 || s.node(k0) != i || s.preorder(i) != k0) return false;
+        if (s.findClose(i) != c || s.findOpen(c) != i || s.subtreeSize(i) != (c-i+1)/2) return false;
+        if (s.depth(i) != st.size() || s.parent(i) != ((st.empty())? npos : st.back())) return false;
+        if (s.firstChild(i) != ((bv[i+1])? npos : i+1)) return false;
+        if (s.nextSibling(i) != ((c+1 < N && !bv[c+1])? c+1 : npos)) return false;
+        st.pb(i); ++k0;
+    }
+    return true;
+}
+
+// Check that a centroid tree file reads back as the centroid tree written to it, and that its shape supports navigation
+// @param path      path of the file, in the binary format
+// @param ct        centroid tree written to it
+// @return          true if the file holds the same shape and IDs, and 'checkNavigation()' holds on its shape, false otherwise
+template<typename I>
+inline bool checkCtFile(const string &path, const basic_c_tree<I> &ct) { // Complexity: O(n*log(n))
+    struct mapped_file f;
+    bool ok = false;
+    try {
+        f = mapFile(path);
+        basic_c_tree<I> r = readCt<I>(f);
+        ok = (r.shape.size() == ct.shape.size() && r.shape.w == ct.shape.w && r.ids == ct.ids && checkNavigation(r.shape));
+    } catch (const char* err) {}
+    unmapFile(f);
+    return ok;
+}
+
+// Check that a centroid tree file written with the original IDs of the nodes reads back as the centroid tree written to it, and that its shape supports navigation
+// @param path      path of the file, in the binary format [with 32-bit IDs]
+// @param ct        centroid tree written to it
+// @param id_ref    nodes reference vector
+// @param labels    original ID of each node (in BFS order)
+// @return          true if the file holds the same shape and IDs, and 'checkNavigation()' holds on its shape, false otherwise
+template<typename I>
+inline bool checkCtFile(const string &path, const basic_c_tree<I> &ct, const vector<I> &id_ref, const vector<uint32_t> &labels) { // Complexity: O(n*log(n))
+    basic_c_tree<uint32_t> out;
+    out.shape = ct.shape;
+    out.ids = vector<uint32_t>(ct.ids.size());
+    for (size_t i = 0; i < ct.ids.size(); ++i) out.ids[i] = labels[std::lower_bound(id_ref.begin(), id_ref.end(), ct.ids[i]) - id_ref.begin()];
+    return checkCtFile(path, out);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include "main.hpp"
+#include "decomposer.hpp"
+using namespace std;
+
+/*
+ * LIBRARY IMPLEMENTATION [the only translation unit of 'libcd.a']
+ */
+
+struct cd_decomposer::workspace : cd_workspace<uint32_t> {
+
+    // Replace the IDs of the centroid tree (positions on T) with the BFS ranks of the nodes [through T itself, whose content is no longer needed after the decomposition]
+    void rankIds() { // Complexity: O(n)
+        for (uint32_t v = 0; v < id_ref.size(); ++v) t[id_ref[v]] = v;
+        for (uint32_t &x : ct.ids) x = t[x];
+    }
+
+};
+
+cd_decomposer::cd_decomposer(const cd_params &p) : p(p), w(new workspace()) {}
+
+cd_decomposer::~cd_decomposer() {
+    delete w;
+}
+
+cd_decomposer::cd_decomposer(cd_decomposer &&d) noexcept : p(d.p), w(d.w) {
+    d.w = nullptr;
+}
+
+cd_decomposer &cd_decomposer::operator=(cd_decomposer &&d) noexcept {
+    std::swap(p, d.p); std::swap(w, d.w);
+    return *this;
+}
+
+void cd_decomposer::decompose(const char *tree, const size_t len) { // Complexity: O(n)
+    if (!w) w = new workspace();
+    w->decompose(tree, len, p.A, p.B);
+    w->rankIds();
+}
+
+void cd_decomposer::decompose(const uint64_t *bits, const uint64_t n) { // Complexity: O(n)
+    if (!w) w = new workspace();
+    struct bp_header h = {};
+    h.n = n;
+    w->decompose(h, bits, p.A, p.B);
+    w->rankIds();
+}
+
+uint64_t cd_decomposer::size() const { // Complexity: O(1)
+    return ((w)? w->ct.ids.size() : 0);
+}
+
+const uint64_t *cd_decomposer::shape() const { // Complexity: O(1)
+    return ((w)? w->ct.shape.w.data() : nullptr);
+}
+
+const uint32_t *cd_decomposer::ids() const { // Complexity: O(1)
+    return ((w)? w->ct.ids.data() : nullptr);
+}
+
+bool cd_decomposer::check() const { // Complexity: O(n*log(n))
+    if (!w) return false;
+    basic_c_tree<uint32_t> ct = w->ct; // Back to the positions on T
+    for (uint32_t &x : ct.ids) x = w->id_ref[x];
+    return checkCorrectness(ct, w->id_ref, w->t.size());
+}
+
+void cd_decomposer::release() { // Complexity: O(1)
+    if (w) *w = workspace();
+}
+
+size_t cd_decomposer::bytes() const { // Complexity: O(1)
+    return ((w)? sizeof(workspace) + w->bytes() : 0);
+}
@@ -0,0 +1,73 @@
+#ifndef DECOMPOSER
+#define DECOMPOSER
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * LIBRARY INTERFACE
+ */
+
+// This header is all that a program linked to 'libcd.a' includes: the algorithms stay behind 'src/decomposer.cpp', so neither 'using namespace std' nor the macros of 'main.hpp' leak into the caller.
+
+// Parameters of the decomposition
+struct cd_params {
+    uint32_t A = 0; // Minimum size of cover elements - log(n) if 0
+    uint64_t B = 0; // Threshold for standard centroid decomposition - (log(n))^3 if 0
+};
+
+// Linear centroid decomposition of trees, one at a time, with 32-bit node IDs
+// The decomposer owns T, T2, the nodes reference vector, the scratch space and the centroid tree, which every call rebuilds in place: once the biggest tree has been decomposed, no more memory is allocated.
+// Decomposers share no state, so each thread can use its own. Errors are thrown as C strings.
+struct cd_decomposer {
+
+    struct workspace; // Structures of the algorithm [opaque]
+
+    // Create an empty decomposer
+    // @param p             parameters of the decomposition
+    cd_decomposer(const cd_params &p = cd_params());
+    ~cd_decomposer();
+    cd_decomposer(const cd_decomposer&) = delete;
+    cd_decomposer &operator=(const cd_decomposer&) = delete;
+    cd_decomposer(cd_decomposer &&d) noexcept;
+    cd_decomposer &operator=(cd_decomposer &&d) noexcept;
+
+    // Decompose a tree given in BP representation
+    // @param tree          BP representation of tree ('(' and ')' characters)
+    // @param len           length of the BP representation
+    void decompose(const char *tree, const std::size_t len);
+
+    // Decompose a tree given in packed BP representation
+    // @param bits          packed BP representation of tree (bit i of word i/64 is 1 for "(", 0 for ")")
+    // @param n             number of nodes
+    void decompose(const uint64_t *bits, const uint64_t n);
+
+    // Get the number of nodes of the last tree
+    // @return              number of nodes
+    uint64_t size() const;
+
+    // Get the shape of the last centroid tree
+    // @return              BP representation as 2n bits in 64-bit words (bit i of word i/64 is 0 for "(", 1 for ")")
+    const uint64_t *shape() const;
+
+    // Get the node IDs of the last centroid tree
+    // @return              n node IDs, in preorder [a node is identified by its rank in the BFS order of the input tree]
+    const uint32_t *ids() const;
+
+    // Check correctness of the last centroid tree [allocates temporary memory: meant for testing]
+    // @return              true if centroid tree is correct, false otherwise
+    bool check() const;
+
+    // Free the memory held by the decomposer [the next call allocates it again]
+    void release();
+
+    // Get the memory held by the decomposer
+    // @return              size of the containers, in bytes
+    std::size_t bytes() const;
+
+    cd_params p; // Parameters of the decomposition
+    workspace *w; // Structures of the algorithm
+
+};
+
+#endif
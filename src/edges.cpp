@@ -0,0 +1,173 @@
+#ifndef EDGES
+#define EDGES
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * EDGE LIST AND PARENT ARRAY INGESTION
+ */
+
+// Group values by key [counting sort]
+// Groups are stable (i.e. in the order of 'i') when run on a single thread, and sorted when run in parallel
+// @param n         number of keys
+// @param m         number of values
+// @param key       key of the i-th value, called as key(i)
+// @param val       i-th value, called as val(i)
+// @param off       offsets of the groups (n+1 entries)
+// @param out       grouped values
+// @param threads   number of threads
+template<typename K, typename V>
+inline void groupBy(const uint32_t n, const uint64_t m, K key, V val, vector<uint32_t> &off, vector<uint32_t> &out, const uint32_t threads = 1) { // Complexity: O(n+m) [plus sorting the groups, if in parallel]
+    off = vector<uint32_t>(n+1, 0);
+    out = vector<uint32_t>(m);
+    if (threads <= 1) {
+        for (uint64_t i = 0; i < m; ++i) ++off[key(i)+1]; // Count
+        for (uint32_t i = 0; i < n; ++i) off[i+1] += off[i]; // Prefix sum
+        for (uint64_t i = 0; i < m; ++i) out[off[key(i)]++] = val(i); // Scatter
+        for (uint32_t i = n; i > 0; --i) off[i] = off[i-1]; // Restore offsets
+        off[0] = 0;
+        return;
+    }
+    parallelFor(threads, m, [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) __atomic_fetch_add(&off[key(i)+1], 1, __ATOMIC_RELAXED); }); // Count
+    for (uint32_t i = 0; i < n; ++i) off[i+1] += off[i]; // Prefix sum
+    vector<uint32_t> pos(off.begin(), off.end()-1);
+    parallelFor(threads, m, [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) out[__atomic_fetch_add(&pos[key(i)], 1, __ATOMIC_RELAXED)] = val(i); }); // Scatter
+    parallelFor(threads, n, [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) std::sort(out.begin()+off[i], out.begin()+off[i+1]); }); // Sort groups
+}
+
+// Build minimal T structure from the adjacency lists of a tree [BFS visit]
+// @param off       offsets of the adjacency lists (n+1 entries)
+// @param adj       adjacency lists [neighbors or children of each node]
+// @param root      root of the tree
+// @param labels    output vector mapping the BFS rank of each node (i.e. its rank on T) to its original ID
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> bfsLayout(const vector<uint32_t> &off, const vector<uint32_t> &adj, const uint32_t root, vector<uint32_t> &labels, const uint32_t threads = 1) { // Complexity: O(n)
+    uint32_t n = off.size() - 1;
+    if (root >= n) throw "Malformed tree: invalid root.";
+    if (n > max_n<I>) throw "Tree is too big: index overflow.";
+    vector<uint32_t> rank(n, n); // BFS rank of each node (n if not yet visited)
+    vector<I> first(n+1); first[n] = n; // BFS rank of the first child of each node
+    labels = vector<uint32_t>(n);
+    labels[0] = root; rank[root] = 0;
+    uint32_t tail = 1;
+    for (uint32_t b = 0; b < tail; ++b) {
+        uint32_t v = labels[b];
+        first[b] = tail;
+        for (uint32_t i = off[v]; i < off[v+1]; ++i) {
+            uint32_t w = adj[i];
+            if (rank[w] != n) continue; // Parent
+            rank[w] = tail; labels[tail] = w; ++tail;
+        }
+    }
+    if (tail != n) throw "Malformed tree: not connected.";
+    return layoutTree<I>(first, threads);
+}
+
+// Build minimal T structure from an edge list
+// @param n         number of nodes
+// @param edges     n-1 edges, as pairs of node IDs in [0,n)
+// @param labels    output vector mapping the BFS rank of each node to its original ID
+// @param root      node to be used as root
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> buildTreeFromEdges(const uint32_t n, const uint32_t *edges, vector<uint32_t> &labels, const uint32_t root = 0, const uint32_t threads = 1) { // Complexity: O(n)
+    if (n == 0) throw "Malformed tree: empty.";
+    uint64_t m = 2*uint64_t(n-1); // Number of arcs
+    if (n > max_n<I> || m > numeric_limits<uint32_t>::max()) throw "Tree is too big: index overflow."; // Checked before grouping: the offsets of the arcs are 32-bit
+    for (uint64_t i = 0; i < m; ++i) if (edges[i] >= n) throw "Malformed tree: invalid node ID.";
+    vector<uint32_t> off, adj;
+    groupBy(n, m, [&](uint64_t i) { return edges[i^1]; }, [&](uint64_t i) { return edges[i]; }, off, adj, threads); // Arcs (u,v) and (v,u) for each edge (u,v)
+    if (threads <= 1) { // Group again, visiting sources in increasing order: neighbors get sorted
+        vector<uint32_t> src(m);
+        for (uint32_t v = 0; v < n; ++v) for (uint32_t i = off[v]; i < off[v+1]; ++i) src[i] = v;
+        vector<uint32_t> sorted;
+        groupBy(n, m, [&](uint64_t i) { return adj[i]; }, [&](uint64_t i) { return src[i]; }, off, sorted);
+        adj.swap(sorted);
+    }
+    return bfsLayout<I>(off, adj, root, labels, threads);
+}
+
+// Build minimal T structure from a parent array
+// @param n         number of nodes
+// @param parents   parent of each node [the root is its own parent]
+// @param labels    output vector mapping the BFS rank of each node to its original ID
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> buildTreeFromParents(const uint32_t n, const uint32_t *parents, vector<uint32_t> &labels, const uint32_t threads = 1) { // Complexity: O(n)
+    if (n == 0) throw "Malformed tree: empty.";
+    if (n > max_n<I> || n == numeric_limits<uint32_t>::max()) throw "Tree is too big: index overflow."; // Checked before grouping: the n+1 groups are counted on 32 bits
+    uint32_t root = n;
+    for (uint32_t v = 0; v < n; ++v) {
+        if (parents[v] >= n) throw "Malformed tree: invalid node ID.";
+        if (parents[v] == v) { if (root != n) throw "Malformed tree: multiple roots."; root = v; }
+    }
+    if (root == n) throw "Malformed tree: no root.";
+    vector<uint32_t> off, adj;
+    groupBy(n+1, n, [&](uint64_t v) { return ((v == root)? n : parents[v]); }, [&](uint64_t v) { return uint32_t(v); }, off, adj, threads); // Children of each node [the root is grouped alone, as last]
+    off.pop_back(); // Drop the root's group
+    return bfsLayout<I>(off, adj, root, labels, threads);
+}
+
+// Parse the node IDs of a text file [whitespace-separated, "-1" is read as the node itself]
+// @param f         mapped file
+// @return          parsed IDs
+inline vector<uint32_t> parseIds(const struct mapped_file &f) { // Complexity: O(length of the file)
+    vector<uint32_t> ids;
+    const char *c = f.data, *e = f.data + f.len;
+    while (c < e) {
+        while (c < e && isspace(*c)) ++c;
+        if (c == e) break;
+        bool neg = (*c == '-'); if (neg) ++c; // Only "-1" is allowed
+        if (c == e || !isdigit(*c)) throw "Malformed tree: invalid character.";
+        uint64_t x = 0;
+        while (c < e && isdigit(*c)) { x = 10*x + (*c - '0'); ++c; }
+        if (x > 0xffffffff || (neg && x != 1)) throw "Malformed tree: invalid node ID.";
+        ids.pb((neg)? (ids.size() - 1) : x); // The first ID is the number of nodes: the i-th parent is at position i+1
+    }
+    return ids;
+}
+
+// Load a tree from a (text or binary) edge list
+// Text format: number of nodes, then n-1 pairs of node IDs
+// @param f         mapped file
+// @param labels    output vector mapping the BFS rank of each node to its original ID
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> loadEdges(const struct mapped_file &f, vector<uint32_t> &labels, const uint32_t threads = 1) { // Complexity: O(n)
+    if (f.size >= sizeof(ids_header) && memcmp(f.addr, el_magic, sizeof(el_magic)) == 0) { // Binary
+        const struct ids_header *h = (const struct ids_header*)f.addr;
+        if (h->n > numeric_limits<uint32_t>::max()) throw "Tree is too big: index overflow."; // Node IDs are 32-bit
+        if (h->n == 0 || f.size < sizeof(ids_header) + 8*(h->n-1)) throw "Malformed tree: truncated file.";
+        return buildTreeFromEdges<I>(h->n, (const uint32_t*)(h+1), labels, 0, threads);
+    }
+    vector<uint32_t> ids = parseIds(f);
+    if (ids.empty() || ids.size() != 2*uint64_t(ids[0])-1) throw "Malformed tree: wrong number of edges.";
+    return buildTreeFromEdges<I>(ids[0], ids.data()+1, labels, 0, threads);
+}
+
+// Load a tree from a (text or binary) parent array
+// Text format: number of nodes, then the parent of each node [the root is its own parent, or -1]
+// @param f         mapped file
+// @param labels    output vector mapping the BFS rank of each node to its original ID
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> loadParents(const struct mapped_file &f, vector<uint32_t> &labels, const uint32_t threads = 1) { // Complexity: O(n)
+    if (f.size >= sizeof(ids_header) && memcmp(f.addr, pa_magic, sizeof(pa_magic)) == 0) { // Binary
+        const struct ids_header *h = (const struct ids_header*)f.addr;
+        if (h->n > numeric_limits<uint32_t>::max()) throw "Tree is too big: index overflow."; // Node IDs are 32-bit
+        if (f.size < sizeof(ids_header) + 4*h->n) throw "Malformed tree: truncated file.";
+        return buildTreeFromParents<I>(h->n, (const uint32_t*)(h+1), labels, threads);
+    }
+    vector<uint32_t> ids = parseIds(f);
+    if (ids.empty() || ids.size() != uint64_t(ids[0])+1) throw "Malformed tree: wrong number of parents.";
+    return buildTreeFromParents<I>(ids[0], ids.data()+1, labels, threads);
+}
+
+#endif
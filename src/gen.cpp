@@ -0,0 +1,126 @@
+#ifndef GEN
+#define GEN
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * TREE GENERATORS
+ */
+
+// Completely random tree [each step either opens a new node or closes the current one, with the same probability]
+// @param w         output writer
+// @param n         number of nodes
+// @param rng       random number generator
+inline void genRandom(struct bp_writer &w, uint64_t n, mt19937_64 &rng) { // Complexity: O(n)
+    uint64_t layer = 0;
+    while (n > 0) {
+        if ((rng() & 1) == 0 && layer > 1) { // Layer check before closing node
+            w.close();
+            layer--;
+        } else {
+            w.open();
+            layer++; n--;
+        }
+    }
+    for (; layer > 0; layer--) w.close(); // Close each "unclosed" node
+}
+
+// Path of nodes with degree 'k', each one with a random number of leaves before the next node of the path
+// @param w         output writer
+// @param n         number of nodes
+// @param k         degree of the nodes of the path (1 <= k <= n)
+// @param rng       random number generator
+inline void genPath(struct bp_writer &w, uint64_t n, const uint64_t k, mt19937_64 &rng) { // Complexity: O(n)
+    string e;
+    int64_t m = n;
+    w.open(); e += ")"; --m; // Root of the tree
+    while (m > 0) {
+        uint64_t c = 1 + (rng() % k);
+        for (uint64_t i = 0; i < c-1; ++i) w.put("()");
+        for (uint64_t i = 0; i < k-c; ++i) e += ")(";
+        w.open(); e += ")";
+        m -= k;
+    }
+    reverse(e.begin(), e.end());
+    w.put(e);
+}
+
+// Root with n/k chains of 'k' nodes
+// @param w         output writer
+// @param n         number of nodes
+// @param k         number of nodes of each chain (1 <= k <= n)
+inline void genChains(struct bp_writer &w, const uint64_t n, const uint64_t k) { // Complexity: O(n)
+    w.open(); // Root of the tree
+    for (uint64_t i = 0; i < n/k; ++i) {
+        for (uint64_t j = 0; j < k; ++j) w.open();
+        for (uint64_t j = 0; j < k; ++j) w.close();
+    }
+    w.close();
+}
+
+// Binary tree with height n/2
+// @param w         output writer
+// @param n         number of nodes
+inline void genBinaryHalfn(struct bp_writer &w, const uint64_t n) { // Complexity: O(n)
+    for (uint64_t i = 0; i < n/2; ++i) w.put("(()");
+    w.put("()");
+    for (uint64_t i = 0; i < n/2; ++i) w.close();
+}
+
+// Star (root with n-1 leaves)
+// @param w         output writer
+// @param n         number of nodes
+inline void genStar(struct bp_writer &w, const uint64_t n) { // Complexity: O(n)
+    w.open(); // Root of the tree
+    for (uint64_t i = 1; i < n; ++i) w.put("()");
+    w.close();
+}
+
+// Caterpillar: a spine of 'k' nodes, with the remaining n-k nodes evenly spread as leaves hanging from it
+// @param w         output writer
+// @param n         number of nodes
+// @param k         length of the spine (1 <= k <= n)
+inline void genCaterpillar(struct bp_writer &w, const uint64_t n, const uint64_t k) { // Complexity: O(n)
+    uint64_t l = (n-k) / k, r = (n-k) % k; // Leaves of each spine node (the first 'r' ones get one more)
+    for (uint64_t i = 0; i < k; ++i) {
+        w.open();
+        for (uint64_t j = 0; j < l + (i < r); ++j) w.put("()");
+    }
+    for (uint64_t i = 0; i < k; ++i) w.close(); // Close the spine
+}
+
+// Broom: a handle (path) of 'k' nodes, the last of which has the remaining n-k nodes as leaves
+// @param w         output writer
+// @param n         number of nodes
+// @param k         length of the handle (1 <= k <= n)
+inline void genBroom(struct bp_writer &w, const uint64_t n, const uint64_t k) { // Complexity: O(n)
+    for (uint64_t i = 0; i < k; ++i) w.open(); // Handle
+    for (uint64_t i = k; i < n; ++i) w.put("()"); // Bristles
+    for (uint64_t i = 0; i < k; ++i) w.close();
+}
+
+// Names of the generators
+const vector<string> generators = {"random", "path", "chains", "binary_halfn", "star", "caterpillar", "broom"};
+
+// Generate a tree by name
+// @param w         output writer
+// @param g         name of the generator
+// @param n         number of nodes
+// @param k         additional parameter (ignored by random, binary_halfn and star)
+// @param seed      random seed
+inline void generateTree(struct bp_writer &w, const string &g, const uint64_t n, const uint64_t k, const uint64_t seed) { // Complexity: O(n)
+    mt19937_64 rng(seed);
+    bool needs_k = (g == "path" || g == "chains" || g == "caterpillar" || g == "broom");
+    if (n < 1 || (needs_k && (k < 1 || k > n))) throw "Invalid generator parameters.";
+    if (g == "random") genRandom(w, n, rng);
+    else if (g == "path") genPath(w, n, k, rng);
+    else if (g == "chains") genChains(w, n, k);
+    else if (g == "binary_halfn") genBinaryHalfn(w, n);
+    else if (g == "star") genStar(w, n);
+    else if (g == "caterpillar") genCaterpillar(w, n, k);
+    else if (g == "broom") genBroom(w, n, k);
+    else throw "Unknown tree generator.";
+}
+
+#endif
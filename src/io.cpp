@@ -0,0 +1,312 @@
+#ifndef IO
+#define IO
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * INPUT/OUTPUT
+ */
+
+// Memory-mapped input file
+struct mapped_file {
+    void *addr = nullptr; // Start of the mapping
+    size_t size = 0; // Size of the mapping
+    const char *data = nullptr; // Content of the file (leading and trailing whitespaces excluded)
+    size_t len = 0; // Length of the content
+};
+
+// Map a file in memory (read-only), hinting the kernel about a sequential access pattern
+// @param path      path of the file
+// @return          mapped file
+inline struct mapped_file mapFile(const string &path) { // Complexity: O(1) [plus the whitespaces at its ends]
+    struct mapped_file f;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw "Cannot open input file.";
+    struct stat st;
+    if (fstat(fd, &st) < 0) { close(fd); throw "Cannot read input file."; }
+    f.size = st.st_size;
+    if (f.size > 0) {
+        f.addr = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (f.addr == MAP_FAILED) { close(fd); throw "Cannot map input file."; }
+        madvise(f.addr, f.size, MADV_SEQUENTIAL);
+        madvise(f.addr, f.size, MADV_WILLNEED);
+    }
+    close(fd); // The mapping keeps its own reference to the file
+    // Skip whitespaces at both ends of the file
+    const char *b = (const char*)f.addr, *e = b + f.size;
+    while (b < e && isspace(*b)) ++b;
+    while (e > b && isspace(*(e-1))) --e;
+    f.data = b; f.len = e - b;
+    return f;
+}
+
+// Unmap a file from memory
+// @param f         mapped file
+inline void unmapFile(struct mapped_file &f) { // Complexity: O(1)
+    if (f.addr) munmap(f.addr, f.size);
+    f = mapped_file();
+}
+
+// Get the header of a mapped packed BP tree
+// @param f         mapped file
+// @return          header of the packed tree, or nullptr if the file is not in the packed format
+inline const struct bp_header *packedTree(const struct mapped_file &f) { // Complexity: O(1)
+    if (f.size < sizeof(bp_header) || memcmp(f.addr, bp_magic, sizeof(bp_magic)) != 0) return nullptr;
+    const struct bp_header *h = (const struct bp_header*)f.addr;
+    if (f.size < sizeof(bp_header) + 8*((2*h->n + 63)/64)) throw "Malformed tree: truncated file.";
+    return h;
+}
+
+// Get the parentheses of a mapped packed BP tree
+// @param f         mapped file
+// @return          packed parentheses
+inline const uint64_t *packedBits(const struct mapped_file &f) { // Complexity: O(1)
+    return (const uint64_t*)((const char*)f.addr + sizeof(bp_header));
+}
+
+// Check if a file holds a tree in the packed BP format
+// @param path      path of the file
+// @return          true if the file starts with the packed BP format identifier
+inline bool isPackedTree(const string &path) { // Complexity: O(1)
+    char magic[sizeof(bp_magic)] = {};
+    ifstream in(path, ios::binary); in.read(magic, sizeof(magic));
+    return (in.gcount() == sizeof(magic) && memcmp(magic, bp_magic, sizeof(bp_magic)) == 0);
+}
+
+// Balanced parenthesis writer, emitting either the text or the packed BP format
+struct bp_writer {
+
+    vector<uint64_t> bits; // Packed parentheses
+    uint64_t len = 0; // Number of parentheses
+    vector<uint64_t> deg; // Number of children of the open nodes (one per level)
+    uint64_t depth = 0, max_depth = 0, max_deg = 0; // Shape statistics (for the header)
+
+    // Append "("
+    void open() {
+        if (len % 64 == 0) bits.pb(0);
+        bits.back() |= (1ull << (len % 64)); ++len;
+        if (depth > 0) max_deg = std::max(max_deg, ++deg[depth-1]); // Add a child to the parent
+        if (deg.size() <= depth) deg.pb(0);
+        deg[depth] = 0; ++depth;
+        max_depth = std::max(max_depth, depth);
+    }
+
+    // Append ")"
+    void close() {
+        if (len % 64 == 0) bits.pb(0);
+        ++len; --depth;
+    }
+
+    // Append a sequence of parentheses
+    // @param bp            BP representation
+    void put(const string &bp) {
+        for (const char c : bp) ((c == '(')? open() : close());
+    }
+
+    // Get the header of the packed BP format
+    // @return              header
+    struct bp_header header() const {
+        struct bp_header h;
+        memcpy(h.magic, bp_magic, sizeof(bp_magic));
+        h.n = len / 2; h.max_depth = max_depth; h.max_deg = max_deg;
+        return h;
+    }
+
+    // Write the tree
+    // @param os            output stream
+    // @param packed        write the packed BP format? [text otherwise]
+    void write(ostream &os, const bool packed) {
+        if (packed) {
+            struct bp_header h = header();
+            os.write((const char*)&h, sizeof(h));
+            os.write((const char*)bits.data(), 8*bits.size());
+        } else {
+            string s(len, ')');
+            for (uint64_t i = 0; i < len; ++i) if (bits[i/64] >> (i%64) & 1) s[i] = '(';
+            os << s;
+        }
+    }
+
+};
+
+// Write a centroid tree in the binary format [header, packed shape, raw node IDs]
+// @param os        output stream
+// @param ct        centroid tree pair<shape,ids> (struct) representation
+template<typename I>
+inline void writeCt(ostream &os, const basic_c_tree<I> &ct) { // Complexity: O(n)
+    struct ct_header h;
+    memcpy(h.magic, ct_magic, sizeof(ct_magic));
+    h.n = ct.ids.size(); h.width = sizeof(I);
+    os.write((const char*)&h, sizeof(h));
+    os.write((const char*)ct.shape.w.data(), 8*ct.shape.w.size());
+    os.write((const char*)ct.ids.data(), sizeof(I)*ct.ids.size());
+}
+
+// Write a centroid tree in the binary format, with the original IDs of the nodes [as 32-bit IDs]
+// @param os        output stream
+// @param ct        centroid tree pair<shape,ids> (struct) representation
+// @param id_ref    nodes reference vector
+// @param labels    original ID of each node (in BFS order)
+template<typename I>
+inline void writeCt(ostream &os, const basic_c_tree<I> &ct, const vector<I> &id_ref, const vector<uint32_t> &labels) { // Complexity: O(n*log(n))
+    basic_c_tree<uint32_t> out;
+    out.shape = ct.shape;
+    out.ids = vector<uint32_t>(ct.ids.size());
+    for (size_t i = 0; i < ct.ids.size(); ++i) out.ids[i] = labels[std::lower_bound(id_ref.begin(), id_ref.end(), ct.ids[i]) - id_ref.begin()];
+    writeCt(os, out);
+}
+
+// Read a centroid tree in the binary format
+// @param f         mapped file
+// @return          centroid tree pair<shape,ids> (struct) representation
+template<typename I>
+inline basic_c_tree<I> readCt(const struct mapped_file &f) { // Complexity: O(n)
+    if (f.size < sizeof(ct_header) || memcmp(f.addr, ct_magic, sizeof(ct_magic)) != 0) throw "Malformed centroid tree: unknown format.";
+    const struct ct_header *h = (const struct ct_header*)f.addr;
+    if (h->width != sizeof(I)) throw "Malformed centroid tree: wrong ID width.";
+    uint64_t words = (2*h->n + 63) / 64;
+    if (f.size < sizeof(ct_header) + 8*words + sizeof(I)*h->n) throw "Malformed centroid tree: truncated file.";
+    basic_c_tree<I> ct;
+    ct.shape.init(2*h->n);
+    const uint64_t *bits = (const uint64_t*)(h+1);
+    std::copy(bits, bits + words, ct.shape.w.begin());
+    const I *ids = (const I*)(bits + words);
+    ct.ids = vector<I>(ids, ids + h->n);
+    return ct;
+}
+
+/*
+ * SNAPSHOTS OF T, ID_REF AND T2
+ */
+
+// Running 64-bit checksum [four independent multiply-xorshift lanes, word i going to lane i%4, so that it keeps up with the memory bandwidth and doesn't depend on how the words are split between calls]
+struct checksum {
+
+    uint64_t s[4] = {1, 2, 3, 4}; // Lanes
+    uint64_t len = 0; // Number of words added
+
+    // Mix a word
+    // @param x             word
+    // @return              mixed word
+    static uint64_t mix(uint64_t x) {
+        x *= 0x9e3779b97f4a7c15ull;
+        return x ^ (x >> 32);
+    }
+
+    // Add words to the checksum
+    // @param w             words
+    // @param k             number of words
+    void add(const uint64_t *w, const size_t k) {
+        for (size_t i = 0; i < k; ++i) s[(len+i)%4] = mix(s[(len+i)%4] ^ w[i]);
+        len += k;
+    }
+
+    // Get the checksum
+    // @return              checksum of the words added so far
+    uint64_t get() const {
+        uint64_t h = mix(len);
+        for (uint32_t j = 0; j < 4; ++j) h = mix(h ^ s[j]);
+        return h;
+    }
+
+};
+
+// Checksum of a buffer [padded with zeros to a multiple of 8 bytes]
+// @param p         buffer
+// @param bytes     size of the buffer, in bytes
+// @return          checksum
+inline uint64_t checksumOf(const void *p, const size_t bytes) { // Complexity: O(bytes)
+    struct checksum c;
+    c.add((const uint64_t*)p, bytes/8);
+    uint64_t last = 0;
+    if (bytes%8) { memcpy(&last, (const char*)p + bytes/8*8, bytes%8); c.add(&last, 1); }
+    return c.get();
+}
+
+// Write a snapshot of T, id_ref and T2, so that later runs can skip their building [to be taken after the covering, before the decomposition]
+// @param os        output stream
+// @param t         covered T representation
+// @param id_ref    nodes reference vector
+// @param t2        minimal T2 representation
+// @param A         minimum size of the cover elements
+// @param labels    original ID of each node (in BFS order) [empty if the nodes have none]
+template<typename I>
+inline void writeSnapshot(ostream &os, const vector<I> &t, const vector<I> &id_ref, const vector<I> &t2, const uint32_t A, const vector<uint32_t> &labels) { // Complexity: O(n)
+    struct snap_header h = {};
+    memcpy(h.magic, snap_magic, sizeof(snap_magic));
+    h.width = sizeof(I); h.n = id_ref.size(); h.A = A;
+    h.t_size = t.size(); h.t2_size = t2.size(); h.labels_size = labels.size();
+    h.t_sum = checksumOf(t.data(), sizeof(I)*t.size());
+    h.id_sum = checksumOf(id_ref.data(), sizeof(I)*id_ref.size());
+    h.t2_sum = checksumOf(t2.data(), sizeof(I)*t2.size());
+    h.labels_sum = checksumOf(labels.data(), 4*labels.size());
+    h.h_sum = checksumOf(&h, offsetof(snap_header, h_sum));
+    os.write((const char*)&h, sizeof(h));
+    const uint64_t zero = 0;
+    auto section = [&](const void *p, size_t bytes) { os.write((const char*)p, bytes); os.write((const char*)&zero, (8 - bytes%8) % 8); };
+    section(t.data(), sizeof(I)*t.size());
+    section(id_ref.data(), sizeof(I)*id_ref.size());
+    section(t2.data(), sizeof(I)*t2.size());
+    section(labels.data(), 4*labels.size());
+    if (!os) throw "Cannot write snapshot file.";
+}
+
+// Copy a section of a mapped snapshot to a container, computing its checksum on the way [in chunks, so that each one is read from memory once]
+// @param p         start of the section [moved to the next section]
+// @param v         output container [its memory is reused]
+// @param k         number of elements of the section
+// @param verify    compute the checksum? [otherwise the section is only copied]
+// @return          checksum of the section [0 if not computed]
+template<typename I>
+inline uint64_t copySection(const char *&p, vector<I> &v, const uint64_t k, const bool verify = true) { // Complexity: O(k)
+    constexpr uint64_t chunk = (1 << 16) / sizeof(I); // Elements per chunk
+    struct checksum c;
+    const I *a = (const I*)p;
+    p += (sizeof(I)*k + 7) / 8 * 8;
+    if (!verify) { v.assign(a, a+k); return 0; }
+    v.clear(); v.reserve(k);
+    for (uint64_t i = 0; i < k; i += chunk) {
+        uint64_t e = std::min(chunk, k-i);
+        c.add((const uint64_t*)(a+i), (sizeof(I)*e + 7) / 8); // Padding included
+        v.insert(v.end(), a+i, a+i+e);
+    }
+    return c.get();
+}
+
+// Load a snapshot of T, id_ref and T2
+// The file is mapped read-only and its sections are copied to the containers: the algorithms take 'std::vector's, which can neither adopt the pages of a mapping nor be resized without writing every element, and the decomposition rewrites T and grows T2.
+// The header, the sizes and the file size are always checked, while the checksums of the sections, which take a pass over the whole file, only if asked.
+// @param path      path of the snapshot file
+// @param t         output covered T representation [its memory is reused]
+// @param id_ref    output nodes reference vector [its memory is reused]
+// @param t2        output minimal T2 representation [its memory is reused]
+// @param labels    output original ID of each node (in BFS order) [empty if the nodes have none]
+// @param verify    verify the checksums of the sections?
+// @return          minimum size of the cover elements used for the snapshot
+template<typename I>
+inline uint32_t loadSnapshot(const string &path, vector<I> &t, vector<I> &id_ref, vector<I> &t2, vector<uint32_t> &labels, const bool verify = true) { // Complexity: O(n)
+    struct mapped_file f = mapFile(path);
+    try {
+        if (f.size < sizeof(snap_header) || memcmp(f.addr, snap_magic, sizeof(snap_magic)) != 0) throw "Malformed snapshot: unknown format.";
+        const struct snap_header *h = (const struct snap_header*)f.addr;
+        if (h->h_sum != checksumOf(h, offsetof(snap_header, h_sum))) throw "Malformed snapshot: wrong header checksum.";
+        if (h->width != sizeof(I)) throw "Malformed snapshot: wrong ID width.";
+        if (h->n == 0 || h->t_size != 5*h->n-2 || (h->t2_size+3) % 8 != 0 || (h->labels_size != 0 && h->labels_size != h->n)) throw "Malformed snapshot: inconsistent sizes.";
+        auto padded = [](uint64_t bytes) { return (bytes + 7) / 8 * 8; };
+        if (f.size != sizeof(snap_header) + padded(sizeof(I)*h->t_size) + padded(sizeof(I)*h->n) + padded(sizeof(I)*h->t2_size) + padded(4*h->labels_size)) throw "Malformed snapshot: wrong file size.";
+        const char *p = (const char*)(h+1);
+        if (copySection(p, t, h->t_size, verify) != h->t_sum && verify) throw "Malformed snapshot: wrong checksum of T.";
+        if (copySection(p, id_ref, h->n, verify) != h->id_sum && verify) throw "Malformed snapshot: wrong checksum of id_ref.";
+        if (copySection(p, t2, h->t2_size, verify) != h->t2_sum && verify) throw "Malformed snapshot: wrong checksum of T2.";
+        if (copySection(p, labels, h->labels_size, verify) != h->labels_sum && verify) throw "Malformed snapshot: wrong checksum of the node IDs.";
+        uint32_t A = h->A;
+        unmapFile(f);
+        return A;
+    } catch (const char* err) {
+        unmapFile(f);
+        throw;
+    }
+}
+
+#endif
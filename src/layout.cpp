@@ -0,0 +1,72 @@
+#ifndef LAYOUT
+#define LAYOUT
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * TREELET-CONTIGUOUS LAYOUT OF T
+ */
+
+// Relabeling of T in which the nodes of each treelet are contiguous
+// Nodes are listed in their new order, which is also the order of their positions on the relabeled T.
+template<typename I = uint32_t>
+struct treelet_layout {
+
+    vector<I> pos; // Position on the relabeled T of each node
+    vector<I> orig; // Position on the original T of each node
+
+    // Map positions on the relabeled T back to the ones on the original T [through T itself, whose content is no longer needed after the decomposition]
+    // @param ids           positions to map [e.g. the IDs of a centroid tree]
+    // @param t             relabeled T [overwritten]
+    // @param threads       number of threads
+    void restoreIds(vector<I> &ids, vector<I> &t, const uint32_t threads = 1) const { // Complexity: O(n+k) work where k = ids.size()
+        auto run = [&](uint64_t n, auto f) { if (threads > 1) parallelFor(threads, n, f); else f(0, n, 0); };
+        run(pos.size(), [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t x = b; x < e; ++x) t[pos[x]] = orig[x]; });
+        run(ids.size(), [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) ids[i] = t[ids[i]]; });
+    }
+
+};
+
+// Relabel a covered T so that the nodes of each treelet are contiguous, in DFS order within the treelet, and the treelets follow the order of their nodes on T2
+// The descent of 'findCentroid()' inside a treelet and the size updates of 'rmNodeOnT()' then stay on a few cache lines, instead of jumping across the levels of the BFS layout.
+// Each node keeps its children in the same order, with the same partial sizes and cover flag, so the decomposition makes the same choices: only the IDs change, and 'restoreIds()' maps them back.
+// @param t         covered T representation [replaced by the relabeled one]
+// @param t2        minimal T2 representation [its references to T are updated]
+// @return          relabeling of T
+template<typename I>
+struct treelet_layout<I> relabelTree(vector<I> &t, vector<I> &t2) { // Complexity: O(n)
+    struct treelet_layout<I> l;
+    I n = sizeOfT(t);
+    l.pos.reserve(n); l.orig.reserve(n);
+    // Step 1 - new order [DFS of each treelet, not descending into the cover elements below it], with the new position of each node saved in its slot field
+    vector<I> s; // DFS stack
+    I q = 0; // Position of the next node on the relabeled T
+    for (size_t j = 0; j < t2.size(); j += childOnT2(0, t2[j])) {
+        s.pb(t2[alpha(I(j))]);
+        while (!s.empty()) {
+            I i = s.back(); s.pop_back();
+            l.pos.pb(q); l.orig.pb(i);
+            t[slotOnT(i)] = q; q += 2*(t[i]&num_c<I>)+3;
+            for (I k = (t[i]&num_c<I>); k > 0; --k) if (!(t[t[childOnT(i, k-1)]]&cov_el<I>)) s.pb(t[childOnT(i, k-1)]);
+        }
+    }
+    // Step 2 - relabeled T [every node writes its own header and children, and the slot of each child]
+    vector<I> nt = vector<I>(t.size());
+    for (I x = 0; x < n; ++x) {
+        I i = l.orig[x], p = l.pos[x];
+        nt[p] = t[i];
+        nt[parnt(p)] = t[slotOnT(t[parnt(i)])];
+        for (I k = 0; k < (t[i]&num_c<I>); ++k) {
+            I c = t[slotOnT(t[childOnT(i, k)])];
+            nt[childOnT(p, k)] = c; nt[sizeOfChildOnT(p, k)] = t[sizeOfChildOnT(i, k)];
+            nt[slotOnT(c)] = k;
+        }
+    }
+    // Step 3 - references of T2
+    for (size_t j = 0; j < t2.size(); j += childOnT2(0, t2[j])) t2[alpha(I(j))] = t[slotOnT(t2[alpha(I(j))])];
+    t.swap(nt);
+    return l;
+}
+
+#endif
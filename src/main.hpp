@@ -6,8 +6,30 @@
 #include <stack>
 #include <chrono>
 #include <algorithm>
+#include <cstring>
+#include <limits>
 #include <unistd.h>
-#include "utils.cpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <charconv>
+#include <cstddef>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(__BMI2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #ifndef MAIN_HPP
 #define MAIN_HPP
@@ -16,43 +38,170 @@
 #define iss             istringstream
 #define oss             ostringstream
 
-constexpr uint32_t max_deg = 0x7fffffff; // Max out-degree of the tree
+template<typename I> constexpr I num_c = I(~I(0)) >> 1; // Bitmask to extract number of children
+template<typename I> constexpr I cov_el = I(~num_c<I>); // Bitmask to extract 'cov_el' flag
+template<typename I> constexpr I max_deg = num_c<I>; // Max out-degree of the tree
+template<typename I> constexpr uint64_t max_n = uint64_t(std::numeric_limits<I>::max()) / 5; // Max number of nodes (positions on T must fit in type 'I')
 constexpr uint32_t max_A = 0xffff; // Max "A"
 constexpr char nl = '\n';
-constexpr uint32_t num_c = 0x7fffffff; // Bitmask to extract number of children
-constexpr uint32_t cov_el = 0x80000000; // Bitmask to extract 'cov_el' flag
 inline constexpr uint32_t pow2(const uint32_t n) { return (1 << n); }
 inline constexpr uint32_t log2(const uint32_t n) { return (31 - __builtin_clz(n)); }
-inline uint32_t sizeOfT(const std::vector<uint32_t> &t) { return (t.size() + 2) / 4; }
-inline uint32_t sizeOfT2(const std::vector<uint32_t> &t2) { return (t2.size() + 3) / 7; }
-inline constexpr uint32_t parnt(const uint32_t i) { return (i + 1); }
-inline constexpr uint32_t childOnT(const uint32_t base, const uint32_t i) { return (base + (2 * i) + 2); }
-inline constexpr uint32_t sizeOfChildOnT(const uint32_t base, const uint32_t i) { return (childOnT(base, i) + 1); }
-inline constexpr uint32_t childOnT2(const uint32_t base, const uint32_t i) { return (base + (3 * i) + 4); }
-inline constexpr uint32_t delta1OfChildOnT2(const uint32_t base, const uint32_t i) { return (childOnT2(base, i) + 1); }
-inline constexpr uint32_t delta2OfChildOnT2(const uint32_t base, const uint32_t i) { return (childOnT2(base, i) + 2); }
-inline constexpr uint32_t alpha(const uint32_t i) { return (i + 3); }
+inline constexpr uint32_t log2(const uint64_t n) { return (63 - __builtin_clzll(n)); }
+template<typename I> inline I sizeOfT(const std::vector<I> &t) { return (t.size() + 2) / 5; }
+template<typename I> inline I sizeOfT2(const std::vector<I> &t2) { return (t2.size() + 3) / 8; }
+template<typename I> inline constexpr I parnt(const I i) { return (i + 1); }
+template<typename I> inline constexpr I slotOnT(const I i) { return (i + 2); }
+template<typename I, typename J> inline constexpr I childOnT(const I base, const J i) { return (base + (2 * i) + 3); }
+template<typename I, typename J> inline constexpr I sizeOfChildOnT(const I base, const J i) { return (childOnT(base, i) + 1); }
+template<typename I> inline constexpr I slotOnT2(const I i) { return (i + 4); }
+template<typename I, typename J> inline constexpr I childOnT2(const I base, const J i) { return (base + (3 * i) + 5); }
+template<typename I, typename J> inline constexpr I delta1OfChildOnT2(const I base, const J i) { return (childOnT2(base, i) + 1); }
+template<typename I, typename J> inline constexpr I delta2OfChildOnT2(const I base, const J i) { return (childOnT2(base, i) + 2); }
+template<typename I> inline constexpr I alpha(const I i) { return (i + 3); }
 
 /**
  * DATA TYPES
  */
 
-// Centroid tree
-struct c_tree {
-    std::vector<uint8_t> shape;
-    std::vector<uint32_t> ids;
+// Packed bit vector (bit i is bit i%64 of word i/64)
+struct bitvector {
+
+    std::vector<uint64_t> w; // Words
+    std::size_t len = 0; // Number of bits
+
+    // Initialize the container (all bits are 0)
+    // @param n             number of bits
+    void init(std::size_t n) {
+        w.assign((n + 63) / 64, 0);
+        len = n;
+    }
+
+    // Get the number of bits
+    // @return              number of bits
+    std::size_t size() const {
+        return len;
+    }
+
+    // Get a bit
+    // @param i             position of the bit
+    // @return              value of the bit
+    bool operator[](std::size_t i) const {
+        return (w[i/64] >> (i%64)) & 1;
+    }
+
+    // Set a bit
+    // @param i             position of the bit
+    // @param b             new value of the bit
+    void set(std::size_t i, bool b = true) {
+        w[i/64] = (w[i/64] & ~(1ull << (i%64))) | (uint64_t(b) << (i%64));
+    }
+
+    // Get a bit [safe while other threads are setting bits of the same word]
+    // @param i             position of the bit
+    // @return              value of the bit
+    bool getSync(std::size_t i) const {
+        return (__atomic_load_n(&w[i/64], __ATOMIC_RELAXED) >> (i%64)) & 1;
+    }
+
+    // Set a bit to 1 [safe while other threads are setting bits of the same word]
+    // @param i             position of the bit
+    void setSync(std::size_t i) {
+        __atomic_fetch_or(&w[i/64], 1ull << (i%64), __ATOMIC_RELAXED);
+    }
+
+};
+
+// Centroid tree (with node IDs of type 'I')
+template<typename I>
+struct basic_c_tree {
+    bitvector shape; // BP representation ("(" is 0, ")" is 1)
+    std::vector<I> ids; // Node IDs (in preorder)
+};
+using c_tree = basic_c_tree<uint32_t>;
+
+// Map from the positions of the nodes on T to their BFS ranks [a bit per word of T, set on the first word of each node, and the number of set bits before each 64-bit word]
+template<typename I>
+struct rank_map {
+
+    bitvector b; // First word of each node
+    std::vector<I> c; // Number of nodes before each word of 'b'
+
+    // Initialize the map
+    // @param t             T representation [only the number of children of the nodes is read]
+    void init(const std::vector<I> &t) {
+        b.init(t.size());
+        for (std::size_t i = 0; i < t.size(); i += 2*(t[i]&num_c<I>)+3) b.set(i);
+        c.resize(b.w.size());
+        I k = 0;
+        for (std::size_t j = 0; j < b.w.size(); ++j) { c[j] = k; k += __builtin_popcountll(b.w[j]); }
+    }
+
+    // Get the BFS rank of a node
+    // @param i             position of the node on T
+    // @return              BFS rank of the node
+    I operator()(std::size_t i) const {
+        return c[i/64] + __builtin_popcountll(b.w[i/64] & ((1ull << (i%64)) - 1));
+    }
+
+};
+
+// Centroid tree as parent and depth arrays (with node IDs of type 'I') [each node is identified by its BFS rank]
+template<typename I>
+struct basic_c_parents {
+    std::vector<I> par; // Parent of each node on the centroid tree (the root is its own parent)
+    std::vector<uint8_t> depth; // Depth of each node on the centroid tree (0 for the root)
+    rank_map<I> rank; // BFS ranks of the nodes of T
+};
+using c_parents = basic_c_parents<uint32_t>;
+
+// Header of the packed BP format (followed by the 2n parentheses, one bit each, in 64-bit words)
+struct bp_header {
+    char magic[8]; // Format identifier and version
+    uint64_t n; // Number of nodes
+    uint64_t max_depth; // Number of levels [0 if unknown]
+    uint64_t max_deg; // Max out-degree [0 if unknown]
+};
+constexpr char bp_magic[8] = {'B', 'P', 'T', 'R', 'E', 'E', '\0', '\1'}; // Packed BP format, version 1
+
+// Header of the binary edge list and parent array formats (followed by n-1 pairs of 32-bit node IDs, or by n 32-bit parent IDs)
+struct ids_header {
+    char magic[8]; // Format identifier and version
+    uint64_t n; // Number of nodes
+};
+constexpr char el_magic[8] = {'T', 'E', 'D', 'G', 'E', 'S', '\0', '\1'}; // Binary edge list, version 1
+constexpr char pa_magic[8] = {'T', 'P', 'A', 'R', 'E', 'N', '\0', '\1'}; // Binary parent array, version 1
+
+// Header of the binary centroid tree format (followed by the 2n parentheses, one bit each, in 64-bit words, and by the n node IDs)
+struct ct_header {
+    char magic[8]; // Format identifier and version
+    uint64_t n; // Number of nodes
+    uint64_t width; // Size of a node ID, in bytes
+};
+constexpr char ct_magic[8] = {'C', 'T', 'R', 'E', 'E', '\0', '\0', '\1'}; // Binary centroid tree, version 1
+
+// Header of the snapshot format (followed by T, id_ref, T2 and the original IDs of the nodes, each one padded to a multiple of 8 bytes)
+struct snap_header {
+    char magic[8]; // Format identifier and version
+    uint64_t width; // Size of a node ID, in bytes
+    uint64_t n; // Number of nodes
+    uint64_t A; // Minimum size of the cover elements [0 for the default, log(n)]
+    uint64_t t_size, t2_size, labels_size; // Number of words of T and T2, and of original IDs [0 if the nodes have none]
+    uint64_t t_sum, id_sum, t2_sum, labels_sum; // Checksums of the sections
+    uint64_t h_sum; // Checksum of the header, up to this field
 };
+constexpr char snap_magic[8] = {'C', 'D', 'S', 'N', 'A', 'P', '\0', '\1'}; // Snapshot of T, id_ref and T2 after the covering, version 1
 
 // Custom stack 
+template<typename I = uint32_t>
 struct stk {
 
-    std::vector<uint32_t> s; // Stack container
-    uint32_t i; // First free position in the stack (e.g. size of the stack)
+    std::vector<I> s; // Stack container
+    std::size_t i; // First free position in the stack (e.g. size of the stack)
 
     // Initialize the container
     // @param max_size      maximum size the stack will be
     void init(std::size_t max_size) {
-        s = std::vector<uint32_t>(max_size);
+        s.resize(max_size);
         i = 0;
     }
 
@@ -70,14 +219,14 @@ struct stk {
 
     // Push an element to the stack
     // @param n             element to push
-    void push(uint32_t n) {
+    void push(I n) {
         s[i] = n;
         ++i;
     }
 
     // Get the top element of the stack
     // @return              top element in the stack
-    uint32_t &top() {
+    I &top() {
         return s[i-1];
     }
 
@@ -88,4 +237,112 @@ struct stk {
     
 };
 
+// Scratch space of the linear centroid decomposition [reused by every split, so that the main loop doesn't allocate memory]
+template<typename I = uint32_t>
+struct cd_scratch {
+
+    std::vector<I> order; // Visit of a connected component on T2
+    std::vector<I> children; // Children on T2 of the centroid treelet
+    std::vector<I> deltas; // First delta of each of them
+    std::vector<std::pair<I,I>> c_ref; // Children reference vector
+    std::vector<I> c, cd; // Children of a new node on T2, and their first deltas
+    std::vector<I> comps; // Roots on T2 of the new connected components
+    std::vector<I> head, next; // Buckets of the children reference vector [first entry of each bucket, and next entry of each entry]
+
+    // Initialize the containers
+    // @param m             number of nodes of T2
+    // @param deg           max out-degree of T
+    void init(std::size_t m, std::size_t deg) {
+        order.clear(); order.reserve(m);
+        children.clear(); children.reserve(m);
+        deltas.clear(); deltas.reserve(m);
+        c_ref.clear(); c_ref.reserve(m);
+        c.clear(); c.reserve(m);
+        cd.clear(); cd.reserve(m);
+        comps.clear(); comps.reserve(deg+1);
+        head.assign(deg+1, 0);
+        next.clear(); next.reserve(m);
+    }
+
+};
+
+// Local copy of a connected component of T, with local IDs of type 'L' [assigned in BFS order from the root of the component, so that the children of a node start out consecutive]
+// As on T, the size of a subtree is stored with the reference to it in the children of its parent, but child IDs and sizes are kept in two separate arrays, so that the heavy-child scans read the sizes alone.
+template<typename I, typename L>
+struct local_tree {
+
+    // Node of the local tree
+    struct node {
+        L par; // Parent (the root of a connected component is its own parent)
+        L slot; // Position among the children of the parent
+        L nc; // Number of children
+        L off; // Offset of the children in 'kids' and 'csize'
+    };
+
+    std::vector<node> v; // Nodes
+    std::vector<L> kids; // Children of the nodes
+    std::vector<L> csize; // Sizes of the subtrees of the children of the nodes
+    std::vector<I> id; // ID on T of each node
+    std::vector<L> s; // Stack with roots of connected components yet to process
+
+    // Initialize the containers
+    // @param m             maximum number of nodes
+    void init(std::size_t m) {
+        v.resize(m);
+        kids.resize(m);
+        csize.resize(m);
+        id.resize(m);
+        s.resize(m);
+    }
+
+};
+
+// Scratch space of the small-component kernel [16-bit local IDs while the components allow them, so that a component of a few thousand nodes fits in L1]
+template<typename I = uint32_t>
+struct small_scratch {
+
+    local_tree<I, uint16_t> l16; // Components of up to 2^16-1 nodes
+    local_tree<I, uint32_t> l32; // Components of up to 2^32-1 nodes
+
+    // Initialize the containers
+    // @param m             maximum size of a component
+    void init(std::size_t m) {
+        l16.init(std::min<std::size_t>(m, std::numeric_limits<uint16_t>::max()));
+        if (m > std::numeric_limits<uint16_t>::max()) l32.init(std::min<std::size_t>(m, std::numeric_limits<uint32_t>::max()));
+    }
+
+};
+
+// Scratch space of the cover of T [cover elements, and buffers of their sort]
+template<typename I = uint32_t>
+struct cover_scratch {
+    std::vector<I> x; // Sizes and levels of the nodes of T
+    std::vector<std::tuple<I,I,I,I>> q, aux; // Cover elements, as tuples <depth, pre_ord, size, t_node>
+    std::vector<std::size_t> cnt; // Digit counters
+};
+
+// Scratch space of a whole linear centroid decomposition [kept between trees, the containers only grow up to the biggest tree seen]
+template<typename I = uint32_t>
+struct cd_buffers {
+    cover_scratch<I> cs; // Cover of T
+    stk<I> s; // Connected components yet to process
+    cd_scratch<I> sc; // Splits of the connected components
+    small_scratch<I> ss; // Small components
+};
+
+#include "perf.cpp"
+#include "pool.cpp"
+#include "simd.cpp"
+#include "utils.cpp"
+#include "parallel.cpp"
+#include "layout.cpp"
+#include "batch.cpp"
+#include "ooc.cpp"
+#include "io.cpp"
+#include "edges.cpp"
+#include "bp.cpp"
+#include "oracle.cpp"
+#include "tune.cpp"
+#include "gen.cpp"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+#ifndef OOC
+#define OOC
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * OUT-OF-CORE DECOMPOSITION
+ */
+
+// Spill files backing the arrays that do not fit in RAM
+// An array is spilled by remapping the whole pages of its reserved (and still untouched) capacity onto an unlinked file: the vector keeps its type and its buffer, so every algorithm works on it as is, but its pages are written back to the file and evicted by the kernel under memory pressure, instead of staying resident.
+// Remapping with MAP_FIXED is only safe on a buffer that has a mapping of its own: glibc serves the allocations above M_MMAP_THRESHOLD with a dedicated 'mmap()', with the buffer right after a chunk header at the start of a page. The threshold is pinned by 'init()' (glibc would raise it dynamically), smaller arrays always stay in RAM, and 'place()' refuses a buffer whose offset in its page does not match [arrays are only spilled when built against glibc].
+// The threshold is process-wide and cannot be given back to glibc's dynamic adjustment: after 'init()', every allocation of the process above 1 MiB is memory-mapped.
+// The pages of a buffer are given back as anonymous memory before it is freed, either by 'place()' (when the array is placed again) or by 'release()'.
+struct spill_space {
+
+    static constexpr size_t mmap_threshold = (1 << 20); // Size above which allocations are memory-mapped [and arrays can be spilled]
+
+    string dir; // Directory of the spill files
+    size_t budget = 0; // Bytes of arrays that may stay in RAM
+    size_t in_ram = 0, on_disk = 0; // Bytes of the arrays placed so far
+    string spilled; // Names of the spilled arrays
+    vector<tuple<const void*,char*,size_t>> areas; // Remapped pages: buffer they belong to, start, length
+
+    spill_space() = default;
+    spill_space(const spill_space&) = delete;
+    spill_space &operator=(const spill_space&) = delete;
+    ~spill_space() { try { release(); } catch (const char*) {} } // On failure the pages stay on their spill file until the arrays are freed, which unmaps them
+
+    // Initialize the spill space
+    // @param d         directory of the spill files [on a disk, not on a tmpfs]
+    // @param b         bytes of arrays that may stay in RAM
+    void init(const string &d, const size_t b) { // Complexity: O(1)
+        dir = d; budget = b;
+        reset();
+#ifdef __GLIBC__
+        if (!mallopt(M_MMAP_THRESHOLD, mmap_threshold)) throw "Cannot set the memory-mapping threshold."; // Process-wide
+#endif
+    }
+
+    // Forget the arrays placed so far, giving their spilled pages back [to be called before placing the arrays of another tree]
+    void reset() { // Complexity: O(k) where k = areas.size()
+        release();
+        in_ram = 0; on_disk = 0; spilled.clear();
+    }
+
+    // Reserve room for an array, in RAM if it fits the budget left, or in a spill file otherwise [arrays should be placed from the most frequently accessed one]
+    // @param v         array [emptied]
+    // @param n         number of elements
+    // @param name      name of the array [for the report]
+    template<typename T>
+    void place(vector<T> &v, const size_t n, const char *name) { // Complexity: O(k) where k = areas.size()
+        bool ok = true;
+        for (size_t i = 0; i < areas.size(); ) { // Give back the pages of the current buffer before it is freed
+            if (get<0>(areas[i]) != v.data()) { ++i; continue; }
+            ok &= remapAnonymous(get<1>(areas[i]), get<2>(areas[i]));
+            areas[i] = areas.back(); areas.pop_back();
+        }
+        if (!ok) throw "Cannot unmap spill file.";
+        vector<T>().swap(v); // Fresh, untouched capacity
+        v.reserve(n);
+        size_t bytes = n*sizeof(T);
+        if (in_ram + bytes <= budget || bytes <= mmap_threshold) { in_ram += bytes; return; }
+        size_t pg = sysconf(_SC_PAGESIZE);
+#ifdef __GLIBC__
+        if (uintptr_t(v.data()) % pg > 2*sizeof(size_t)) throw "Cannot spill an array that is not memory-mapped."; // Not at the start of its own mapping [page-aligned, or after the chunk header of glibc]
+#else
+        throw "Cannot spill an array: the layout of the allocations is only known for glibc.";
+#endif
+        on_disk += bytes;
+        spilled += ((spilled.empty())? "" : ", "); spilled += name;
+        uintptr_t b = (uintptr_t(v.data()) + pg-1) / pg * pg, e = (uintptr_t(v.data()) + bytes) / pg * pg; // Whole pages of the buffer [the partial ones at its ends stay in RAM]
+        if (e <= b) return;
+        string path = dir + "/cdspill-XXXXXX";
+        int fd = mkstemp(path.data());
+        if (fd < 0) throw "Cannot create spill file.";
+        unlink(path.c_str()); // Deleted as soon as it is unmapped
+        if (ftruncate(fd, e-b) < 0) { close(fd); throw "Cannot extend spill file."; }
+        void *p = mmap((void*)b, e-b, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd); // The mapping keeps its own reference to the file
+        if (p == MAP_FAILED) throw "Cannot map spill file.";
+        areas.pb({v.data(), (char*)b, e-b});
+    }
+
+    // Give the spilled pages back to the allocator as plain anonymous memory [to be called before the arrays are freed, with their content lost]
+    void release() { // Complexity: O(k) where k = areas.size()
+        bool ok = true;
+        for (auto [buf, p, len] : areas) ok &= remapAnonymous(p, len);
+        areas.clear();
+        if (!ok) throw "Cannot unmap spill file.";
+    }
+
+    // Replace spilled pages with plain anonymous memory
+    // @param p         start of the pages
+    // @param len       length of the pages
+    // @return          true if the pages were remapped, false otherwise
+    static bool remapAnonymous(char *p, const size_t len) { // Complexity: O(1)
+        return mmap(p, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED;
+    }
+
+};
+
+// Centroid decomposition algorithm for a T kept (partly) on disk
+// Components bigger than 'B' are split as in 'centroidDecomposition()', and their regions of the output are assigned as in 'parallelCentroidDecomposition()'. Components smaller than 'B' are deferred instead, and decomposed in batches sorted by their root on T: in the BFS layout the nodes of a subtree are contiguous on each level, so each batch sweeps T forward, a few levels at a time, instead of jumping back and forth across it.
+// The output is the same as the one of 'centroidDecomposition()'.
+// @param t         T representation
+// @param t2        T2 representation
+// @param ct        output centroid tree pair<shape,ids> (struct) representation [its memory is reused]
+// @param b         scratch space [its memory is reused]
+// @param B         threshold for standard centroid decomposition - (log(n))^3 if not given
+// @param batch     max number of deferred small components
+template<typename I>
+void oocCentroidDecomposition(vector<I> &t, vector<I> &t2, basic_c_tree<I> &ct, struct cd_buffers<I> &b, uint64_t B = 0, const size_t batch = (1 << 20)) { // Complexity: O(n)
+    I n = sizeOfT(t);
+    B = ((n <= 1)? 1 : ((!B)? (uint64_t(log2(uint64_t(n)))*log2(uint64_t(n))*log2(uint64_t(n))) : B));
+    initOutput(ct, t);
+    small_scratch<I> &ss = b.ss; ss.init(std::min<uint64_t>(B, n)); // Scratch space for the small components
+    cd_scratch<I> &sc = b.sc; sc.init(sizeOfT2(t2), maxDegree(t)); // Scratch space for the splits
+    computeDeltas(t2, sc.order);
+    t2.reserve(2*t2.size()); // Room for the new nodes on T2
+    vector<cd_task<I>> big, small; small.reserve(batch); // Components to split, and deferred small components
+    auto flush = [&]() { // Decompose the deferred components, in the order of their roots on T
+        std::sort(small.begin(), small.end(), [](const cd_task<I> &x, const cd_task<I> &y) { return x.tr < y.tr; });
+        for (const cd_task<I> &c : small) { size_t ptr1 = c.ptr1, ptr2 = c.ptr2; smallCentroidDecomposition(ss, t, ct, c.tr, c.size, ptr1, ptr2); }
+        small.clear();
+    };
+    auto push = [&](const cd_task<I> &c) {
+        if (c.size > B) big.pb(c);
+        else { small.pb(c); if (small.size() == batch) flush(); }
+    };
+    push({0, t2[alpha(0)], n, 0, 0});
+    while (!big.empty()) {
+        cd_task<I> c = big.back(); big.pop_back();
+        I tc = splitComponent(t, t2, c.r, c.size, sc);
+        ct.ids[c.ptr2] = tc; // Print centroid ID [the "(" is already there, as 'ct.shape' is zeroed]
+        ct.shape.set(c.ptr1+2*size_t(c.size)-1); // Print ")"
+        size_t ptr1 = c.ptr1 + 1, ptr2 = c.ptr2 + 1;
+        for (auto it = sc.comps.rbegin(); it != sc.comps.rend(); ++it) { // Assign output regions in the same order of the sequential algorithm
+            I tr = t2[alpha(*it)];
+            I size = 1 + sumOf<2>(t.data()+sizeOfChildOnT(tr, 0), t[tr]&num_c<I>); // Size of connected component
+            push({*it, tr, size, ptr1, ptr2});
+            ptr1 += 2*size; ptr2 += size;
+        }
+    }
+    flush();
+}
+
+// Workspace of the out-of-core linear centroid decomposition
+// The arrays of Theta(n) words are reserved up front, and those that do not fit the RAM budget are spilled to disk. The shape of the centroid tree (2n bits), T2 and the scratch space of the splits (O(n/log(n)) words) always stay in RAM.
+template<typename I = uint32_t>
+struct ooc_workspace {
+
+    vector<I> t, id_ref, t2; // Structures of the tree
+    basic_c_tree<I> ct; // Centroid tree
+    struct cd_buffers<I> b; // Scratch space
+    struct spill_space sp; // Spill files [declared last, so that the arrays are unmapped from them before being freed]
+
+    // Reserve the arrays for a tree, placing them from the most frequently accessed one
+    // @param n         number of nodes
+    // @param A         minimum size of cover elements - log(n) if not given
+    void reserve(const uint64_t n, uint32_t A = 0) { // Complexity: O(1)
+        if (n > max_n<I>) throw "Tree is too big: index overflow.";
+        A = ((!A)? ((n <= 1)? 1 : log2(n)) : A);
+        uint64_t k = n/A + ((n%A == 0)? 0 : 1) + 1; // Upper-bound for number of nodes of T2, as in 'cover()'
+        sp.reset(); // The workspace may have held another tree
+        sp.place(t, std::max<uint64_t>(5*n, 2)-2, "T");
+        sp.place(ct.ids, n, "centroid tree IDs");
+        sp.place(b.cs.x, n, "X");
+        sp.place(id_ref, n, "id_ref");
+        sp.place(b.cs.q, k, "cover elements");
+        sp.place(b.cs.aux, k, "cover elements (sorting buffer)");
+    }
+
+};
+
+#endif
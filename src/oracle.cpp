@@ -0,0 +1,234 @@
+#ifndef ORACLE
+#define ORACLE
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * CENTROID-ANCESTOR DISTANCE ORACLE
+ */
+
+// Table of the centroid ancestors of each node, with the distance to each of them, plus batched queries on top of it
+// Nodes are identified by their BFS rank (i.e. their rank on T, and the index of their original ID in 'labels').
+// The row of node 'v' is 'anc[off[v]...off[v+1]-1]' (and 'dist' at the same positions): its i-th entry is the centroid ancestor of 'v' at depth i in the centroid tree, the last one being 'v' itself.
+template<typename I>
+struct ca_oracle {
+
+    static constexpr I none = numeric_limits<I>::max(); // No node (or infinite distance)
+
+    I n = 0; // Number of nodes
+    vector<I> first; // BFS rank of the first child of each node, followed by the number of nodes
+    vector<I> par; // Parent of each node (the root is its own parent)
+    vector<uint8_t> cdepth; // Depth of each node in the centroid tree
+    vector<I> csize; // Size of the connected component of which each node is the centroid
+    vector<uint64_t> off; // Offsets of the rows (n+1 entries)
+    vector<I> anc; // Centroid ancestors
+    vector<I> dist; // Distances to the centroid ancestors
+    vector<uint64_t> hoff; // Offsets of the histograms of each centroid (n+1 entries)
+    vector<I> hist1; // Number of nodes of the component of each centroid within distance d from it [cumulative, 'csize'+1 entries]
+    vector<I> hist2; // Number of nodes of the component of each centroid within distance d from its parent centroid [cumulative, 'csize'+1 entries]
+    vector<I> best; // Distance from each centroid to the nearest marked node of its component
+
+    // Build the oracle
+    // The original tree is recovered from the node positions on T alone (see 'recoverTree()'), even after the decomposition, which destroys T.
+    // @param ct            centroid tree pair<shape,ids> (struct) representation
+    // @param id_ref        nodes reference vector
+    // @param N             size of T
+    // @param threads       number of threads
+    void init(const basic_c_tree<I> &ct, const vector<I> &id_ref, const size_t N, const uint32_t threads = 1) { // Complexity: O(n*log(n)) work
+        n = id_ref.size();
+        // Step 1 - original tree [first child and parent of each node]
+        recoverTree(id_ref, N, first, par);
+        // Step 2 - depth and component size of each centroid [visit of the centroid tree]
+        cdepth = vector<uint8_t>(n);
+        csize = vector<I>(n);
+        vector<I> order(n); // Centroids in preorder
+        vector<pair<I,size_t>> open; // Open centroids, with their position on the shape
+        for (size_t i = 0, k = 0; i < ct.shape.size(); ++i) {
+            if (!ct.shape[i]) {
+                I v = std::lower_bound(id_ref.begin(), id_ref.end(), ct.ids[k]) - id_ref.begin();
+                order[k++] = v; cdepth[v] = open.size();
+                open.pb({v, i});
+            } else {
+                csize[open.back().first] = (i - open.back().second + 1) / 2;
+                open.pop_back();
+            }
+        }
+        // Step 3 - offsets of the rows and of the histograms
+        off = vector<uint64_t>(n+1, 0);
+        hoff = vector<uint64_t>(n+1, 0);
+        for (I v = 0; v < n; ++v) { off[v+1] = off[v] + cdepth[v] + 1; hoff[v+1] = hoff[v] + csize[v] + 1; }
+        anc = vector<I>(off[n]);
+        dist = vector<I>(off[n]);
+        hist1 = vector<I>(hoff[n], 0);
+        hist2 = vector<I>(hoff[n], 0);
+        best = vector<I>(n, none);
+        // Step 4 - one BFS per centroid, restricted to its component [components at the same depth are disjoint, and each one reads the distances to its parent centroid]
+        vector<vector<I>> level; // Centroids at each depth
+        for (I v : order) { if (level.size() <= cdepth[v]) level.pb({}); level[cdepth[v]].pb(v); }
+        vector<vector<pair<I,I>>> q(std::max(threads, 1u)); // BFS queue of each thread, as pairs <node, node it was reached from>
+        for (I d = 0; d < level.size(); ++d) {
+            const vector<I> &l = level[d];
+            parallelFor(threads, l.size(), [&](uint64_t b, uint64_t e, uint32_t j) {
+                for (uint64_t i = b; i < e; ++i) visit(l[i], q[j]);
+            });
+        }
+        // Step 5 - cumulative histograms
+        parallelFor(threads, n, [&](uint64_t b, uint64_t e, uint32_t j) {
+            for (uint64_t v = b; v < e; ++v) {
+                for (uint64_t h = hoff[v]+1; h < hoff[v+1]; ++h) { hist1[h] += hist1[h-1]; hist2[h] += hist2[h-1]; }
+            }
+        });
+    }
+
+    // Number of centroid ancestors of a node [itself included]
+    // @param v             node
+    // @return              length of the row of 'v'
+    I levels(const I v) const { // Complexity: O(1)
+        return cdepth[v] + 1;
+    }
+
+    // Distance between two nodes [through their deepest common centroid ancestor]
+    // @param u             first node
+    // @param v             second node
+    // @return              distance between 'u' and 'v'
+    I distance(const I u, const I v) const { // Complexity: O(log(n))
+        I i = 0, h = std::min(cdepth[u], cdepth[v]);
+        while (i < h && anc[off[u]+i+1] == anc[off[v]+i+1]) ++i;
+        return dist[off[u]+i] + dist[off[v]+i];
+    }
+
+    // Mark some nodes [for 'nearestMarked()']
+    // @param nodes         nodes to mark
+    void mark(const vector<I> &nodes) { // Complexity: O(k*log(n)) where k = nodes.size()
+        for (I v : nodes) for (uint64_t i = off[v]; i < off[v+1]; ++i) best[anc[i]] = std::min(best[anc[i]], dist[i]);
+    }
+
+    // Unmark all the nodes
+    void clearMarks() { // Complexity: O(n)
+        std::fill(best.begin(), best.end(), none);
+    }
+
+    // Distances from some nodes to the nearest marked node [batched]
+    // @param nodes         query nodes
+    // @param out           output distances ('none' if no node is marked)
+    // @param threads       number of threads
+    void nearestMarked(const vector<I> &nodes, vector<I> &out, const uint32_t threads = 1) const { // Complexity: O(k*log(n)) where k = nodes.size()
+        out = vector<I>(nodes.size());
+        batch(nodes.size(), [&](uint64_t i) { return nodes[i]; }, [&](uint64_t i) {
+            I v = nodes[i], r = none;
+            for (uint64_t j = off[v]; j < off[v+1]; ++j) if (best[anc[j]] != none) r = std::min<I>(r, best[anc[j]] + dist[j]);
+            out[i] = r;
+        }, threads);
+    }
+
+    // Number of nodes within a given distance from some nodes [batched]
+    // Each centroid ancestor 'a' of 'v' contributes the nodes of its component within distance k-dist(v,a) from it, minus the ones of the component containing 'v' (counted by the next ancestor).
+    // @param queries       query pairs <node, distance>
+    // @param out           output counts
+    // @param threads       number of threads
+    void countWithin(const vector<pair<I,I>> &queries, vector<I> &out, const uint32_t threads = 1) const { // Complexity: O(k*log(n)) where k = queries.size()
+        out = vector<I>(queries.size());
+        batch(queries.size(), [&](uint64_t i) { return queries[i].first; }, [&](uint64_t i) {
+            I v = queries[i].first, k = queries[i].second, r = 0;
+            for (uint64_t j = off[v]; j < off[v+1]; ++j) {
+                if (dist[j] > k) continue;
+                I a = anc[j], x = k - dist[j];
+                r += hist1[hoff[a] + std::min<uint64_t>(x, csize[a])];
+                if (j+1 < off[v+1]) { I b = anc[j+1]; r -= hist2[hoff[b] + std::min<uint64_t>(x, csize[b])]; } // Nodes in the component of the next ancestor
+            }
+            out[i] = r;
+        }, threads);
+    }
+
+    private:
+
+    // Visit the component of a centroid, filling its column of the table and its histograms
+    // @param c             centroid
+    // @param q             scratch queue
+    void visit(const I c, vector<pair<I,I>> &q) { // Complexity: O(k) where k = csize[c]
+        uint8_t d = cdepth[c];
+        q.clear(); q.pb({c, c});
+        I x = 0; // Current distance
+        for (size_t b = 0, e = 1; b < q.size(); b = e, e = q.size(), ++x) { // One level of the BFS at a time
+            for (size_t i = b; i < e; ++i) {
+                I u = q[i].first, from = q[i].second;
+                anc[off[u]+d] = c; dist[off[u]+d] = x;
+                ++hist1[hoff[c]+x];
+                if (d > 0) ++hist2[hoff[c]+dist[off[u]+d-1]];
+                if (par[u] != u && par[u] != from && cdepth[par[u]] > d) q.pb({par[u], u});
+                for (I w = first[u]; w < first[u+1]; ++w) if (w != from && cdepth[w] > d) q.pb({w, u});
+            }
+        }
+    }
+
+    // Run a batch of queries, sorted by node [rows are visited in memory order], writing the results in input order
+    // @param k             number of queries
+    // @param node          node of the i-th query, called as node(i)
+    // @param f             query body, called as f(i)
+    // @param threads       number of threads
+    template<typename V, typename F>
+    void batch(const uint64_t k, V node, F f, const uint32_t threads) const {
+        vector<uint64_t> idx(k);
+        for (uint64_t i = 0; i < k; ++i) idx[i] = i;
+        std::sort(idx.begin(), idx.end(), [&](uint64_t a, uint64_t b) { return node(a) < node(b); });
+        parallelFor(threads, k, [&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) f(idx[i]); });
+    }
+
+};
+
+// Check the queries of an oracle against BFS visits of the original tree
+// From each of some random sources, 'distance()' is checked on (a sample of) the nodes and 'countWithin()' on a few radii; 'nearestMarked()' is checked against a BFS from some random marked nodes, and with no node marked. The marks of the oracle are cleared.
+// @param o         oracle
+// @param threads   number of threads
+// @param sources   number of random sources
+// @param seed      random seed
+// @return          true if every query matches the BFS, false otherwise
+template<typename I>
+bool checkOracle(ca_oracle<I> &o, const uint32_t threads = 1, const uint32_t sources = 8, const uint64_t seed = 1) { // Complexity: O(s*n) where s = sources
+    constexpr I none = ca_oracle<I>::none;
+    const I n = o.n;
+    if (n == 0) return true;
+    mt19937_64 rng(seed);
+    vector<I> targets; // Nodes on which the queries are checked [all of them, or a sample on big trees]
+    if (n <= (1 << 16)) { targets.resize(n); for (I v = 0; v < n; ++v) targets[v] = v; }
+    else { targets.resize(1 << 16); for (I &v : targets) v = rng() % n; }
+    vector<I> d(n), q; q.reserve(n);
+    auto bfs = [&](const vector<I> &from) { // Distances from the nearest of some nodes
+        std::fill(d.begin(), d.end(), none);
+        q.clear();
+        for (I v : from) if (d[v] == none) { d[v] = 0; q.pb(v); }
+        for (size_t i = 0; i < q.size(); ++i) {
+            I u = q[i];
+            if (d[o.par[u]] == none) { d[o.par[u]] = d[u] + 1; q.pb(o.par[u]); }
+            for (I w = o.first[u]; w < o.first[u+1]; ++w) if (d[w] == none) { d[w] = d[u] + 1; q.pb(w); }
+        }
+        return q.size() == size_t(n); // The tree is connected
+    };
+    vector<pair<I,I>> cq; vector<I> cnt, out; // Count queries, with the expected counts
+    for (uint32_t k = 0; k < sources; ++k) {
+        I s = rng() % n;
+        if (!bfs({s})) return false;
+        for (I v : targets) if (o.distance(s, v) != d[v] || o.distance(v, s) != d[v]) return false;
+        I h = d[q.back()]; // Eccentricity of 's'
+        vector<I> within(h+1, 0); // Number of nodes within each distance
+        for (I v = 0; v < n; ++v) ++within[d[v]];
+        for (I x = 1; x <= h; ++x) within[x] += within[x-1];
+        for (I x : {I(0), I(1), I(h/4), I(h/2), h, I(h+1), I(rng() % (h+1))}) { cq.pb({s, x}); cnt.pb(within[std::min(x, h)]); }
+    }
+    o.countWithin(cq, out, threads);
+    if (out != cnt) return false;
+    o.clearMarks();
+    o.nearestMarked(targets, out, threads);
+    for (I r : out) if (r != none) return false; // No node marked
+    vector<I> marked(std::min<I>(n, 16));
+    for (I &v : marked) v = rng() % n;
+    o.mark(marked);
+    o.nearestMarked(targets, out, threads);
+    o.clearMarks();
+    bfs(marked);
+    for (size_t i = 0; i < targets.size(); ++i) if (out[i] != d[targets[i]]) return false;
+    return true;
+}
+
+#endif
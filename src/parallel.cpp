@@ -0,0 +1,224 @@
+#ifndef PARALLEL
+#define PARALLEL
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * PARALLEL STRUCTURE BUILDING
+ */
+
+// Build minimal T structure from the BFS rank of the first child of each node [in parallel]
+// Since the children of the BFS-ranked node 'b' are 'first[b]...first[b+1]-1', its position on T is 3*b+2*(first[b]-1).
+// @param first     BFS rank of the first child of each node, followed by the number of nodes
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+vector<I> layoutTree(const vector<I> &first, const uint32_t threads) { // Complexity: O(n/threads) per thread
+    I n = first.size() - 1;
+    if (n <= 1) return vector<I>(3*n, 0); // Single node (or empty tree)
+    I N = (5 * n) - 2; // Size of T
+    uint32_t p = std::max(threads, 1u);
+    vector<I> t = vector<I>(N);
+    atomic<bool> overflow(false);
+    parallelFor(p, n, [&](uint64_t b, uint64_t e, uint32_t j) {
+        for (uint64_t x = b; x < e; ++x) {
+            I i = 3*x + 2*(first[x]-1); // Node ID
+            I nc = first[x+1] - first[x]; // Number of children
+            if (nc > max_deg<I>) { overflow = true; return; } // Check for out-degree overflow
+            t[i] = nc;
+            for (I k = 0; k < nc; ++k) {
+                I c = first[x] + k, y = 3*c + 2*(first[c]-1); // Child's BFS rank and ID
+                t[childOnT(i, k)] = y; // Write child's ID
+                t[parnt(y)] = i; t[slotOnT(y)] = k; // Store parent of child, and its position among the parent's children
+            }
+        }
+    });
+    if (overflow) throw "Tree is too big: out-degree overflow.";
+    return t;
+}
+
+// Restore T, in place, to the minimal structure it had before the covering and the decomposition
+// Both only rewrite the content of the nodes (flags, sizes, and the order, parents and slots of the children), never their positions: since the node with BFS rank 'b' is at position 3*b+2*(first[b]-1), 'id_ref' alone gives back its first child and number of children.
+// @param t         T representation [covered and/or decomposed]
+// @param id_ref    nodes reference vector
+// @param threads   number of threads
+template<typename I>
+void restoreTree(vector<I> &t, const vector<I> &id_ref, const uint32_t threads = 1) { // Complexity: O(n/threads) per thread
+    size_t n = id_ref.size(), N = t.size();
+    if (n == 0) return;
+    t[parnt(I(0))] = 0; t[slotOnT(I(0))] = 0; // Parent of root = root
+    parallelFor(std::max(threads, 1u), n, [&](uint64_t b, uint64_t e, uint32_t j) {
+        for (uint64_t x = b; x < e; ++x) {
+            I i = id_ref[x]; // Node ID
+            I nc = (((x+1 < n)? size_t(id_ref[x+1]) : N) - i - 3) / 2; // Number of children
+            I f = (i - 3*x) / 2 + 1; // BFS rank of the first child
+            t[i] = nc;
+            for (I k = 0; k < nc; ++k) {
+                I y = id_ref[f+k]; // Child's ID
+                t[childOnT(i, k)] = y; t[sizeOfChildOnT(i, k)] = 0;
+                t[parnt(y)] = i; t[slotOnT(y)] = k;
+            }
+        }
+    });
+}
+
+// Build minimal T structure from balanced parenthesis representation [chunk-wise, in parallel]
+// The BFS rank of a node is the number of nodes at lower levels plus the number of nodes at its level that precede it; the BFS rank of its first child is computed in the same way, one level below.
+// @param tree      BP representation of tree
+// @param len       length of the BP representation
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes), identical to the one of 'buildTree()'
+template<typename I = uint32_t>
+vector<I> buildTreeParallel(const char *tree, const size_t len, const uint32_t threads) { // Complexity: O(n/threads+threads*H) per thread
+    if (len < 2) throw "Malformed tree: empty.";
+    if (len/2 > max_n<I>) throw "Tree is too big: index overflow.";
+    I n = len / 2;
+    uint32_t p = std::max(threads, 1u);
+    // Step 1 - per-chunk summaries [excess, min excess before the last parenthesis and range of depths of the opening parentheses]
+    vector<int64_t> ex(p), mn(p), lo(p), hi(p);
+    vector<uint8_t> bad(p);
+    parallelFor(p, len, [&](uint64_t b, uint64_t e, uint32_t j) {
+        int64_t h = 0, m = INT64_MAX, l = INT64_MAX, u = INT64_MIN;
+        bool x = false; // Any byte other than parentheses?
+        for (uint64_t i = b; i < e; ++i) {
+            if (tree[i] == '(') { l = std::min(l, h); u = std::max(u, h); ++h; }
+            else { x |= (tree[i] != ')'); --h; }
+            if (i+1 < len) m = std::min(m, h);
+        }
+        ex[j] = h; mn[j] = m; lo[j] = l; hi[j] = u; bad[j] = x;
+    });
+    // Step 2 - prefix sum of excesses [depth at the beginning of each chunk]
+    int64_t H = 0, total = 0; // Number of levels and total excess
+    for (uint32_t j = 0; j < p; ++j) {
+        if (bad[j] || (mn[j] != INT64_MAX && total + mn[j] < 1)) throw "Malformed tree: unbalanced parentheses."; // The root can only be closed by the last parenthesis
+        total += ex[j];
+    }
+    if (total != 0) throw "Malformed tree: unbalanced parentheses.";
+    if (n <= 1) return vector<I>(3, 0); // Single node
+    for (int64_t j = 0, d = 0; j < p; d += ex[j], ++j) {
+        if (lo[j] > hi[j]) { lo[j] = 0; hi[j] = -1; } // No opening parentheses
+        lo[j] += d; hi[j] += d + 1; // Absolute range of depths, including the level below (it holds the children)
+        H = std::max(H, hi[j]);
+    }
+    // Step 3 - per-chunk number of nodes for each level
+    vector<vector<I>> cnt(p);
+    parallelFor(p, len, [&](uint64_t b, uint64_t e, uint32_t j) {
+        cnt[j] = vector<I>(std::max<int64_t>(hi[j]-lo[j]+1, 0), 0);
+        int64_t h = 0; for (uint32_t i = 0; i < j; ++i) h += ex[i]; h -= lo[j];
+        for (uint64_t i = b; i < e; ++i) {
+            if (tree[i] == '(') { ++cnt[j][h]; ++h; }
+            else --h;
+        }
+    });
+    // Step 4 - prefix sums [per-chunk offsets on each level, then first BFS rank of each level]
+    vector<I> level(H+2, 0);
+    parallelFor(p, H+1, [&](uint64_t b, uint64_t e, uint32_t j) {
+        for (uint64_t d = b; d < e; ++d) {
+            I psum = 0, tmp;
+            for (uint32_t i = 0; i < p; ++i) {
+                if (int64_t(d) < lo[i] || int64_t(d) > hi[i]) continue;
+                tmp = cnt[i][d-lo[i]];
+                cnt[i][d-lo[i]] = psum;
+                psum += tmp;
+            }
+            level[d] = psum;
+        }
+    });
+    I psum = 0, tmp;
+    for (size_t d = 0; d < level.size(); ++d) {
+        tmp = level[d];
+        level[d] = psum;
+        psum += tmp;
+    }
+    // Step 5 - BFS rank of the first child of each node
+    vector<I> first(n+1); first[n] = n;
+    parallelFor(p, len, [&](uint64_t b, uint64_t e, uint32_t j) {
+        int64_t h = 0; for (uint32_t i = 0; i < j; ++i) h += ex[i];
+        for (uint64_t i = b; i < e; ++i) {
+            if (tree[i] == '(') {
+                I x = level[h] + (cnt[j][h-lo[j]]++); // BFS rank of the node
+                first[x] = level[h+1] + cnt[j][h+1-lo[j]];
+                ++h;
+            } else --h;
+        }
+    });
+    // Step 6 - build T [number of children and parent-children pointers]
+    return layoutTree<I>(first, p);
+}
+
+// Build minimal T structure from balanced parenthesis representation [chunk-wise, in parallel]
+// @param tree      BP representation of tree
+// @param threads   number of threads
+// @return          minimal T representation (no partial sizes), identical to the one of 'buildTree()'
+template<typename I = uint32_t>
+inline vector<I> buildTreeParallel(const string &tree, const uint32_t threads) { // Complexity: O(n/threads+threads*H) per thread
+    return buildTreeParallel<I>(tree.data(), tree.length(), threads);
+}
+
+/*
+ * PARALLEL O(n) CENTROID DECOMPOSITION IMPLEMENTATION
+ */
+
+// Connected component yet to process
+template<typename I>
+struct cd_task {
+    I r; // Root on T2
+    I tr; // Root on T
+    I size; // Number of nodes
+    size_t ptr1; // Position in 'ct.shape'
+    size_t ptr2; // Position in 'ct.ids'
+};
+
+// Parallel centroid decomposition algorithm
+// Connected components are disjoint on T, and so are their regions on the output structure: each one is processed as an independent task by a work-stealing pool.
+// Splits of components bigger than 'B' are serialized (they modify T2), while components smaller than 'B' are decomposed concurrently.
+// @param t         T representation
+// @param t2        T2 representation
+// @param B         threshold for standard centroid decomposition - (log(n))^3 if not given
+// @param threads   number of threads
+// @return          centroid tree pair<shape,ids> (struct) representation
+template<typename I>
+basic_c_tree<I> parallelCentroidDecomposition(vector<I> &t, vector<I> &t2, uint64_t B = 0, const uint32_t threads = 1) { // Complexity: O(n) work
+    I n = sizeOfT(t);
+    B = ((n <= 1)? 1 : ((!B)? (uint64_t(log2(uint64_t(n)))*log2(uint64_t(n))*log2(uint64_t(n))) : B));
+    basic_c_tree<I> ct;
+    ct.shape.init(2*size_t(n));
+    ct.ids = vector<I>(n, 0);
+    ws_pool<cd_task<I>> pool(threads);
+    vector<small_scratch<I>> ss(pool.w.size()); for (small_scratch<I> &s : ss) s.init(std::min<uint64_t>(B, n)); // Scratch space for the small components (one per worker)
+    mutex t2_lock; // Lock on T2 [and on the scratch space of the splits]
+    cd_scratch<I> sc; sc.init(sizeOfT2(t2), maxDegree(t)); // Scratch space for the splits
+    computeDeltas(t2, sc.order);
+    t2.reserve(2*t2.size()); // Room for the new nodes on T2
+    vector<vector<cd_task<I>>> tasks(pool.w.size()); for (auto &v : tasks) v.reserve(sc.comps.capacity()); // New tasks of each worker
+    pool.push(0, {0, t2[alpha(0)], n, 0, 0});
+    pool.run([&](const cd_task<I> &c, const uint32_t id) {
+        if (c.size > B) { // If connected component is bigger than threshold 'B'
+            vector<cd_task<I>> &ts = tasks[id]; ts.clear();
+            I tc;
+            {
+                lock_guard<mutex> lock(t2_lock);
+                tc = splitComponent(t, t2, c.r, c.size, sc);
+                const vector<I> &comps = sc.comps;
+                size_t ptr1 = c.ptr1 + 1, ptr2 = c.ptr2 + 1;
+                for (auto it = comps.rbegin(); it != comps.rend(); ++it) { // Assign output regions in the same order of the sequential algorithm
+                    I tr = t2[alpha(*it)];
+                    I size = 1 + sumOf<2>(t.data()+sizeOfChildOnT(tr, 0), t[tr]&num_c<I>); // Size of connected component
+                    ts.pb({*it, tr, size, ptr1, ptr2});
+                    ptr1 += 2*size; ptr2 += size;
+                }
+            }
+            // Print node to output vectors
+            ct.ids[c.ptr2] = tc; // Print centroid ID [the "(" is already there, as 'ct.shape' is zeroed]
+            ct.shape.setSync(c.ptr1+2*size_t(c.size)-1); // Print ")"
+            for (auto it = ts.rbegin(); it != ts.rend(); ++it) pool.push(id, *it); // Push new connected components to the deque
+        } else { // If connected component is smaller than threshold 'B'
+            size_t ptr1 = c.ptr1, ptr2 = c.ptr2;
+            smallCentroidDecomposition(ss[id], t, ct, c.tr, c.size, ptr1, ptr2);
+        }
+    });
+    return ct;
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef PERF
+#define PERF
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * HARDWARE PERFORMANCE COUNTERS
+ */
+
+constexpr uint32_t perf_events = 5; // Number of hardware events
+const char *const perf_names[perf_events] = {"cycles", "instructions", "LLC misses", "branch misses", "dTLB misses"};
+
+// Hardware performance counters of the calling thread (Linux 'perf_event_open()'), in a single group so that they are read together
+// Events that the machine (or the kernel's 'perf_event_paranoid' setting) does not allow are left out, and read as 0.
+struct perf_counters {
+
+    int leader = -1; // File descriptor of the group leader
+    vector<int> fds; // File descriptors of the group
+    int idx[perf_events]; // Position of each event in the group (-1 if unavailable)
+    string err; // Reason why no counter is available
+
+    // Open and enable the counters
+    // @return              true if at least one counter is available
+    bool open() { // Complexity: O(1)
+#ifdef __linux__
+        const uint32_t types[perf_events] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+        const uint64_t configs[perf_events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        for (uint32_t e = 0; e < perf_events; ++e) {
+            struct perf_event_attr a;
+            memset(&a, 0, sizeof(a));
+            a.size = sizeof(a); a.type = types[e]; a.config = configs[e];
+            a.disabled = (leader < 0); // The whole group is enabled through the leader
+            a.exclude_kernel = 1; a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_GROUP;
+            int fd = syscall(__NR_perf_event_open, &a, 0, -1, leader, 0);
+            if (fd < 0) { idx[e] = -1; if (err.empty()) err = strerror(errno); continue; }
+            if (leader < 0) leader = fd;
+            idx[e] = fds.size(); fds.pb(fd);
+        }
+        if (leader < 0) return false;
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        for (uint32_t e = 0; e < perf_events; ++e) idx[e] = -1;
+        err = "not supported on this platform";
+        return false;
+#endif
+    }
+
+    // Read the counters
+    // @param v             output values (one per event)
+    void read(uint64_t *v) const { // Complexity: O(1)
+        uint64_t buf[perf_events+1]; // Number of events, then their values
+        if (leader < 0 || ::read(leader, buf, sizeof(buf)) <= 0) { for (uint32_t e = 0; e < perf_events; ++e) v[e] = 0; return; }
+        for (uint32_t e = 0; e < perf_events; ++e) v[e] = ((idx[e] >= 0)? buf[idx[e]+1] : 0);
+    }
+
+    // Is an event available?
+    // @param e             event
+    // @return              true if the event is counted
+    bool available(const uint32_t e) const { // Complexity: O(1)
+        return (leader >= 0 && idx[e] >= 0);
+    }
+
+    ~perf_counters() {
+        for (int fd : fds) close(fd);
+    }
+
+};
+
+// Timings and hardware counters of the phases of a run
+// Phases may be nested (e.g. the small-component fallback inside the decomposition), and the outer one then includes the inner ones. Without counters, only the timings are collected.
+struct perf_report {
+
+    // Phase of the run
+    struct phase {
+        string name; // Name of the phase
+        uint64_t calls = 0; // Number of measurements
+        uint64_t ns = 0; // Total time in nanoseconds
+        uint64_t v[perf_events] = {}; // Total value of each event
+        chrono::high_resolution_clock::time_point t; // Start of the current measurement
+        uint64_t s[perf_events] = {}; // Values of the events at the start of the current measurement
+    };
+
+    struct perf_counters c;
+    bool counters = false; // Are the counters available?
+    vector<struct phase> p; // Phases
+
+    // Open the counters
+    void init() { // Complexity: O(1)
+        counters = c.open();
+    }
+
+    // Get the index of a phase, adding it if new
+    // @param name          name of the phase
+    // @return              index of the phase
+    uint32_t phase(const string &name) { // Complexity: O(k) where k = p.size()
+        for (uint32_t i = 0; i < p.size(); ++i) if (p[i].name == name) return i;
+        p.pb({}); p.back().name = name;
+        return p.size()-1;
+    }
+
+    // Start a measurement of a phase
+    // @param i             index of the phase
+    void begin(const uint32_t i) { // Complexity: O(1)
+        if (counters) c.read(p[i].s);
+        p[i].t = chrono::high_resolution_clock::now();
+    }
+
+    // End a measurement of a phase
+    // @param i             index of the phase
+    void end(const uint32_t i) { // Complexity: O(1)
+        chrono::high_resolution_clock::time_point t = chrono::high_resolution_clock::now();
+        p[i].ns += chrono::duration_cast<chrono::nanoseconds>(t-p[i].t).count();
+        ++p[i].calls;
+        if (!counters) return;
+        uint64_t v[perf_events]; c.read(v);
+        for (uint32_t e = 0; e < perf_events; ++e) p[i].v[e] += v[e] - p[i].s[e];
+    }
+
+    // Print the report
+    // @return              formatted report
+    string toString() const { // Complexity: O(k) where k = p.size()
+        oss os;
+        os << "Performance counters" << ((counters)? " (calling thread only):" : (" unavailable (" + c.err + "), timings only:")) << nl;
+        for (const struct phase &q : p) {
+            os << " - " << q.name << ": " << q.ns/1000 << "us" << ((q.calls > 1)? " [" + to_string(q.calls) + " measurements]" : "") << nl;
+            if (!counters) continue;
+            os << "   ";
+            for (uint32_t e = 0; e < perf_events; ++e) os << ((e)? ", " : "") << perf_names[e] << " " << ((c.available(e))? to_string(q.v[e]) : "n/a");
+            if (c.available(0) && c.available(1) && q.v[0]) os << " (IPC " << (q.v[1] * 100 / q.v[0]) / 100.0 << ")";
+            os << nl;
+        }
+        return os.str();
+    }
+
+};
+
+// Measurement of a phase for the lifetime of the object [no-op if the report is nullptr]
+struct perf_scope {
+    struct perf_report *r;
+    uint32_t i;
+    perf_scope(struct perf_report *r, const uint32_t i) : r(r), i(i) { if (r) r->begin(i); }
+    perf_scope(struct perf_report *r, const string &name) : r(r), i((r)? r->phase(name) : 0) { if (r) r->begin(i); }
+    ~perf_scope() { if (r) r->end(i); }
+};
+
+#endif
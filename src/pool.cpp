@@ -0,0 +1,98 @@
+#ifndef POOL
+#define POOL
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * WORK-STEALING THREAD POOL
+ */
+
+// Work-stealing thread pool
+// Each worker owns a deque of tasks: it pushes and pops at the back of its own deque (LIFO, depth-first), while idle workers steal from the front of the others' deques (FIFO, i.e. the biggest pending tasks)
+template<typename T>
+struct ws_pool {
+
+    // Per-worker task queue
+    struct worker {
+        deque<T> q; // Task deque
+        mutex m; // Deque lock
+    };
+
+    vector<worker> w; // Workers
+    atomic<uint64_t> pending; // Number of tasks pushed but not yet completed
+
+    // Initialize the pool
+    // @param threads       number of workers
+    ws_pool(const uint32_t threads) : w(std::max(threads, 1u)), pending(0) {}
+
+    // Push a task to the deque of a worker
+    // @param id            ID of the worker
+    // @param task          task to push
+    void push(const uint32_t id, const T &task) {
+        pending.fetch_add(1);
+        lock_guard<mutex> lock(w[id].m);
+        w[id].q.push_back(task);
+    }
+
+    // Pop a task from the back of the deque of a worker
+    // @param id            ID of the worker
+    // @param task          popped task
+    // @return              true if a task has been popped, false otherwise
+    bool pop(const uint32_t id, T &task) {
+        lock_guard<mutex> lock(w[id].m);
+        if (w[id].q.empty()) return false;
+        task = w[id].q.back(); w[id].q.pop_back();
+        return true;
+    }
+
+    // Steal a task from the front of the deque of any other worker
+    // @param id            ID of the thief
+    // @param task          stolen task
+    // @return              true if a task has been stolen, false otherwise
+    bool steal(const uint32_t id, T &task) {
+        for (uint32_t i = 1; i < w.size(); ++i) {
+            worker &v = w[(id+i) % w.size()]; // Victim
+            lock_guard<mutex> lock(v.m);
+            if (v.q.empty()) continue;
+            task = v.q.front(); v.q.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    // Run the pool until every task (including the ones spawned while running) is completed
+    // Note: tasks are spawned by calling 'push()' with the ID of the worker passed to 'f'
+    // @param f             task body, called as f(task, worker_id)
+    template<typename F>
+    void run(F f) {
+        vector<thread> threads;
+        for (uint32_t id = 0; id < w.size(); ++id) {
+            threads.emplace_back([this, id, &f]() {
+                T task;
+                while (pending.load() > 0) {
+                    if (pop(id, task) || steal(id, task)) {
+                        f(task, id);
+                        pending.fetch_sub(1);
+                    } else this_thread::yield();
+                }
+            });
+        }
+        for (thread &th : threads) th.join();
+    }
+
+};
+
+// Run a loop in parallel, splitting the range [0,n) in equal contiguous chunks
+// @param threads   number of threads (i.e. of chunks)
+// @param n         size of the range
+// @param f         loop body, called as f(begin, end, chunk) for each chunk
+template<typename F>
+inline void parallelFor(const uint32_t threads, const uint64_t n, F f) { // Complexity: O(n/threads) per thread
+    uint32_t p = std::max(threads, 1u);
+    vector<thread> th;
+    for (uint32_t j = 0; j < p; ++j) th.emplace_back([&f, j, p, n]() { f(n*j/p, n*(j+1)/p, j); });
+    for (thread &x : th) x.join();
+}
+
+#endif
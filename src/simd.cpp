@@ -0,0 +1,104 @@
+#ifndef SIMD
+#define SIMD
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * SIMD KERNELS ON CHILD SIZES
+ */
+
+// Scans of the sizes of the children of a node: the heavy-child test ('size > half_size') and the sum of the sizes.
+// Sizes are read every 'S' words: 1 on a contiguous array of sizes, 2 on the interleaved (child, size) pairs of T. AVX-512 and AVX2 versions are used for 16 and 32-bit sizes when the compiler targets them (e.g. with -march=native), and a scalar loop otherwise.
+// Vector loads never read past the last size, which may be the last word of T.
+
+// Position of the first size bigger than a value
+// @param a         sizes
+// @param n         number of sizes
+// @param x         value
+// @return          position of the first size bigger than 'x' ('n' if none)
+template<uint32_t S = 1, typename L>
+inline uint64_t firstGreater(const L *a, const uint64_t n, const L x) { // Complexity: O(n)
+    uint64_t i = 0;
+#if defined(__AVX512BW__)
+    if constexpr (sizeof(L) == 2 && S == 1) {
+        if (n >= 32) {
+            __m512i v = _mm512_set1_epi16(x);
+            for (; i+32 <= n; i += 32) { __mmask32 m = _mm512_cmpgt_epu16_mask(_mm512_loadu_si512(a+i), v); if (m) return i + __builtin_ctz(m); }
+        }
+    } else if constexpr (sizeof(L) == 4 && S <= 2) {
+        if (S*n >= 16+S-1) {
+            __m512i v = _mm512_set1_epi32(x);
+            for (; S*i+16+S-1 <= S*n; i += 16/S) {
+                __mmask16 m = _mm512_cmpgt_epu32_mask(_mm512_loadu_si512(a+S*i), v) & ((S == 1)? 0xffff : 0x5555);
+                if (m) return i + __builtin_ctz(m)/S;
+            }
+        }
+    }
+#elif defined(__AVX2__)
+    if constexpr (sizeof(L) == 2 && S == 1) {
+        if (n >= 16) {
+            __m256i sign = _mm256_set1_epi16(int16_t(0x8000)), v = _mm256_xor_si256(_mm256_set1_epi16(x), sign); // Unsigned comparison through the signed one
+            for (; i+16 <= n; i += 16) {
+                uint32_t m = _mm256_movemask_epi8(_mm256_cmpgt_epi16(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a+i)), sign), v));
+                if (m) return i + __builtin_ctz(m)/2;
+            }
+        }
+    } else if constexpr (sizeof(L) == 4 && S <= 2) {
+        if (S*n >= 8+S-1) {
+            __m256i sign = _mm256_set1_epi32(int32_t(0x80000000)), v = _mm256_xor_si256(_mm256_set1_epi32(x), sign);
+            for (; S*i+8+S-1 <= S*n; i += 8/S) {
+                uint32_t m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a+S*i)), sign), v))) & ((S == 1)? 0xff : 0x55);
+                if (m) return i + __builtin_ctz(m)/S;
+            }
+        }
+    }
+#endif
+    for (; i < n; ++i) if (a[S*i] > x) return i;
+    return n;
+}
+
+// Sum of the sizes [which must fit in type 'L']
+// @param a         sizes
+// @param n         number of sizes
+// @return          sum of the sizes
+template<uint32_t S = 1, typename L>
+inline L sumOf(const L *a, const uint64_t n) { // Complexity: O(n)
+    uint64_t i = 0;
+    L s = 0;
+#if defined(__AVX512BW__)
+    if constexpr (sizeof(L) == 2 && S == 1) {
+        if (n >= 16) {
+            __m512i acc = _mm512_setzero_si512();
+            for (; i+16 <= n; i += 16) acc = _mm512_add_epi32(acc, _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(a+i))));
+            s = _mm512_reduce_add_epi32(acc);
+        }
+    } else if constexpr (sizeof(L) == 4 && S <= 2) {
+        if (S*n >= 16+S-1) {
+            __m512i acc = _mm512_setzero_si512();
+            for (; S*i+16+S-1 <= S*n; i += 16/S) acc = _mm512_add_epi32(acc, _mm512_maskz_loadu_epi32((S == 1)? 0xffff : 0x5555, a+S*i));
+            s = _mm512_reduce_add_epi32(acc);
+        }
+    }
+#elif defined(__AVX2__)
+    if constexpr (sizeof(L) == 2 && S == 1) {
+        if (n >= 8) {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i+8 <= n; i += 8) acc = _mm256_add_epi32(acc, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(a+i))));
+            uint32_t v[8]; _mm256_storeu_si256((__m256i*)v, acc);
+            for (uint32_t k = 0; k < 8; ++k) s += v[k];
+        }
+    } else if constexpr (sizeof(L) == 4 && S <= 2) {
+        if (S*n >= 8+S-1) {
+            __m256i acc = _mm256_setzero_si256(), mask = ((S == 1)? _mm256_set1_epi32(-1) : _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1));
+            for (; S*i+8+S-1 <= S*n; i += 8/S) acc = _mm256_add_epi32(acc, _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a+S*i)), mask));
+            uint32_t v[8]; _mm256_storeu_si256((__m256i*)v, acc);
+            for (uint32_t k = 0; k < 8; ++k) s += v[k];
+        }
+    }
+#endif
+    for (; i < n; ++i) s += a[S*i];
+    return s;
+}
+
+#endif
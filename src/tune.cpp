@@ -0,0 +1,176 @@
+#ifndef TUNE
+#define TUNE
+
+#include "main.hpp"
+using namespace std;
+
+/*
+ * AUTO-TUNING OF THE "A" AND "B" PARAMETERS
+ */
+
+// Shape of a tree
+struct tree_profile {
+    uint64_t n = 0; // Number of nodes
+    uint64_t levels = 0; // Number of levels
+    uint64_t width = 0; // Number of nodes of the widest level
+    uint64_t max_deg = 0; // Max out-degree
+    uint64_t leaves = 0; // Number of leaves
+};
+
+// Sizes of the data caches of the machine, in bytes
+struct cache_info {
+    uint64_t l1 = 0, l2 = 0, l3 = 0;
+};
+
+// Tuned parameters, with the tree and the machine they were tuned on
+struct cd_profile {
+    uint32_t A = 0; // Size of treelets for tree covering
+    uint32_t B = 0; // Threshold for linear centroid decomposition
+    struct tree_profile shape;
+    struct cache_info cache;
+};
+
+// Compute the shape of a tree [levels are contiguous ranges of BFS ranks, and the children of a node follow the ones of the nodes before it]
+// @param t         minimal T representation
+// @param id_ref    nodes reference vector
+// @return          shape of the tree
+template<typename I>
+struct tree_profile profileTree(const vector<I> &t, const vector<I> &id_ref) { // Complexity: O(n)
+    struct tree_profile p;
+    p.n = id_ref.size();
+    uint64_t c = 1, end = 1, begin = 0; // 'c' is the BFS rank of the next child, and the current level is [begin,end)
+    for (uint64_t v = 0; v < p.n; ++v) {
+        if (v == end) { p.width = std::max(p.width, end-begin); ++p.levels; begin = end; end = c; } // Next level
+        uint64_t nc = t[id_ref[v]]&num_c<I>;
+        p.max_deg = std::max(p.max_deg, nc);
+        p.leaves += (nc == 0);
+        c += nc;
+    }
+    if (p.n > 0) { p.width = std::max(p.width, end-begin); ++p.levels; }
+    return p;
+}
+
+// Get the sizes of the data caches, from 'sysconf()' or from sysfs [32 KiB, 1 MiB and 8 MiB are assumed for the unknown ones]
+// @return          sizes of the caches
+inline struct cache_info cacheSizes() { // Complexity: O(1)
+    struct cache_info c;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    c.l1 = std::max(sysconf(_SC_LEVEL1_DCACHE_SIZE), 0l);
+    c.l2 = std::max(sysconf(_SC_LEVEL2_CACHE_SIZE), 0l);
+    c.l3 = std::max(sysconf(_SC_LEVEL3_CACHE_SIZE), 0l);
+#endif
+    for (uint32_t i = 0; i < 8; ++i) { // Fallback: sysfs
+        string dir = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(i) + "/";
+        ifstream fl(dir + "level"), ft(dir + "type"), fs(dir + "size");
+        uint64_t level = 0, size = 0; string type, unit;
+        if (!(fl >> level) || !(ft >> type) || !(fs >> size)) break;
+        fs >> unit;
+        if (unit == "K") size <<= 10;
+        else if (unit == "M") size <<= 20;
+        if (type == "Instruction") continue;
+        uint64_t &s = ((level == 1)? c.l1 : ((level == 2)? c.l2 : c.l3));
+        if (level <= 3 && s == 0) s = size;
+    }
+    if (!c.l1) c.l1 = 32 << 10;
+    if (!c.l2) c.l2 = 1 << 20;
+    if (!c.l3) c.l3 = 8 << 20;
+    return c;
+}
+
+// Extract the first nodes of a tree in preorder, which form a connected subtree with the same depth profile near the root
+// @param t         T representation
+// @param m         number of nodes to extract
+// @return          BP representation of the subtree
+template<typename I>
+string sampleTree(const vector<I> &t, const uint64_t m) { // Complexity: O(m)
+    string bp; bp.reserve(2*m);
+    vector<pair<I,I>> s; // DFS stack, as pairs <node, next child>
+    s.pb({0, 0}); bp.pb('(');
+    uint64_t k = 1; // Extracted nodes
+    while (!s.empty()) {
+        auto &[v, i] = s.back();
+        if (i < (t[v]&num_c<I>) && k < m) {
+            I u = t[childOnT(v, i++)];
+            s.pb({u, 0}); bp.pb('('); ++k;
+        } else { s.pop_back(); bp.pb(')'); }
+    }
+    return bp;
+}
+
+// Choose "A" and "B" by timing a few candidates on a sample of the tree
+// Candidates for "A" are around log(n), while the ones for "B" are the components that fit in the L1 and L2 caches (a node takes about 5 words on T), plus log(n)^3.
+// @param t         minimal T representation [decomposed in place if the sample is the whole tree, and restored afterwards]
+// @param threads   number of threads
+// @param reps      timed runs per candidate (the fastest one counts)
+// @return          tuned parameters
+template<typename I>
+struct cd_profile tuneParameters(vector<I> &t, const uint32_t threads = 1, const uint32_t reps = 2) { // Complexity: O(m) with m = min(n, max(2^18, 4*max(B)))
+    struct cd_profile prof;
+    vector<I> id_ref = buildIdRef(t);
+    prof.shape = profileTree(t, id_ref);
+    prof.cache = cacheSizes();
+    uint64_t n = prof.shape.n, lg = ((n <= 1)? 1 : log2(n));
+    // Candidates
+    vector<uint32_t> as, bs;
+    for (uint64_t a : {std::max<uint64_t>(lg/2, 1), lg, 2*lg, 4*lg}) as.pb(std::min<uint64_t>(a, max_A));
+    for (uint64_t b : {prof.cache.l1/(5*sizeof(I)), prof.cache.l2/(10*sizeof(I)), prof.cache.l2/(5*sizeof(I)), lg*lg*lg}) bs.pb(std::clamp<uint64_t>(b, 16, std::max<uint64_t>(n, 16)));
+    for (auto v : {&as, &bs}) { std::sort(v->begin(), v->end()); v->erase(std::unique(v->begin(), v->end()), v->end()); }
+    prof.A = as[0]; prof.B = bs[0];
+    if (n <= 1) return prof;
+    // Sample
+    uint64_t m = std::min<uint64_t>(n, std::max<uint64_t>(1 << 18, 4*uint64_t(bs.back())));
+    vector<I> sample = ((m < n)? buildTree<I>(sampleTree(t, m)) : vector<I>());
+    vector<I> &ts = ((m < n)? sample : t);
+    if (m < n) id_ref = buildIdRef(ts);
+    // Trial runs
+    uint64_t best = UINT64_MAX;
+    for (uint32_t a : as) for (uint32_t b : bs) {
+        uint64_t time = UINT64_MAX;
+        for (uint32_t r = 0; r < reps; ++r) {
+            chrono::high_resolution_clock::time_point t01 = getTime();
+            vector<I> t2 = cover(ts, id_ref, a, threads);
+            basic_c_tree<I> ct = ((threads > 1)? parallelCentroidDecomposition(ts, t2, b, threads) : centroidDecomposition(ts, t2, b));
+            time = std::min<uint64_t>(time, chrono::duration_cast<chrono::nanoseconds>(getTime()-t01).count());
+            restoreTree(ts, id_ref, threads); // Same tree for the next run
+        }
+        if (time < best) { best = time; prof.A = a; prof.B = b; }
+    }
+    return prof;
+}
+
+// Save tuned parameters to a profile file
+// @param path      path of the profile
+// @param prof      tuned parameters
+inline void saveProfile(const string &path, const struct cd_profile &prof) { // Complexity: O(1)
+    ofstream out(path);
+    if (!out) throw "Cannot write profile file.";
+    out << "A " << prof.A << nl << "B " << prof.B << nl;
+    out << "n " << prof.shape.n << nl << "levels " << prof.shape.levels << nl << "width " << prof.shape.width << nl << "max_deg " << prof.shape.max_deg << nl << "leaves " << prof.shape.leaves << nl;
+    out << "l1 " << prof.cache.l1 << nl << "l2 " << prof.cache.l2 << nl << "l3 " << prof.cache.l3 << nl;
+}
+
+// Load tuned parameters from a profile file
+// @param path      path of the profile
+// @param prof      tuned parameters
+// @return          false if the file does not exist
+inline bool loadProfile(const string &path, struct cd_profile &prof) { // Complexity: O(1)
+    ifstream in(path);
+    if (!in) return false;
+    string key; uint64_t v;
+    while (in >> key >> v) {
+        if (key == "A") prof.A = v;
+        else if (key == "B") prof.B = v;
+        else if (key == "n") prof.shape.n = v;
+        else if (key == "levels") prof.shape.levels = v;
+        else if (key == "width") prof.shape.width = v;
+        else if (key == "max_deg") prof.shape.max_deg = v;
+        else if (key == "leaves") prof.shape.leaves = v;
+        else if (key == "l1") prof.cache.l1 = v;
+        else if (key == "l2") prof.cache.l2 = v;
+        else if (key == "l3") prof.cache.l3 = v;
+    }
+    if (!in.eof() || !prof.A || !prof.B || prof.A > max_A) throw "Malformed profile file.";
+    return true;
+}
+
+#endif
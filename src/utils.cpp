@@ -8,120 +8,305 @@ using namespace std;
  * STRUCTURE BUILDING FUNCTIONS
  */
 
+// Turn the level-wise children counts of 'buildTree()' into the minimal T structure
+// @param t         T, holding in T[H...H+n-1] the number of children of each node (in BFS order)
+// @param n         number of nodes
+// @param H         max height
+template<typename I>
+inline void linkTree(vector<I> &t, const I n, const I H) { // Complexity: O(n)
+    I N = t.size(); // Size of T
+    for (I i = 0; i < n; ++i) t[i] = t[i+H]; // Left-shift T[H...H+n-1] to T[0...n-1]
+    // Build basic T representation (no parent-children pointers)
+    I r = n; // T[r] is the number of children of last allocated node
+    I R = N; // Start position (=ID) in T of last allocated node
+    for(I i = 0; i < n; ++i) {
+        --r; // Process next node (right to left)
+        R -= (2 * t[r]) + 3; // Node ID
+        t[R] = t[r]; // Number of children
+    }
+    // Set parent-children pointers
+    I i = 0, j = 2*t[0] + 3; // 'i' is at level L, 'j' is at level L+1
+    t[1] = 0; t[2] = 0; // Parent of root = root
+    while (j < N) {
+        I x = i; // This node
+        I nc = t[x]; // Number of children of this node
+        i += 3; // Jump to children area
+        for (I k = 0; k < nc; ++k) {
+            t[i] = j; // Write child's ID
+            t[i+1] = 0; // Clear child's size (the area may hold leftovers of the level-wise counts)
+            i += 2; // Jump to next child 
+            t[parnt(j)] = x; // Store parent of 'j'
+            t[slotOnT(j)] = k; // Store position of 'j' among its parent's children
+            j += 2*t[j]+3; // Jump to next child's area
+        }
+    }
+}
+
 // Build minimal T structure from balanced parenthesis representation [level-wise, in-place]
 // @param tree      BP representation of tree
-// @return          minimal T representation (no partial sizes)
-vector<uint32_t> buildTree(const string &tree) { // Complexity: O(n)
-    uint32_t n = tree.length() / 2;
-    uint32_t N = (4 * n) - 2; // Size of T
-    vector<uint32_t> t = vector<uint32_t>(N); // Empty T
-    uint32_t H = 0; // Max height
+// @param len       length of the BP representation
+// @param t         output minimal T representation (no partial sizes) [its memory is reused]
+template<typename I>
+void buildTree(const char *tree, const size_t len, vector<I> &t) { // Complexity: O(n)
+    if (len < 2) throw "Malformed tree: empty.";
+    if (len/2 > max_n<I>) throw "Tree is too big: index overflow.";
+    I n = len / 2;
+    I N = (5 * n) - 2; // Size of T
+    t.assign(N, 0); // Empty T
+    I H = 0; // Max height
     // Compute the number of nodes per level in T[0...H-1]
     int64_t h = 1; // Current height
-    for (uint32_t i = 0; i < tree.length(); ++i) {
+    for (size_t i = 0; i < len; ++i) {
         t[h-1] += (tree[i] == '(');
         h += ((tree[i] == '(')? 1 : -1);
-        H = std::max(uint32_t(h), H); // Also compute max height
+        if ((h <= 1 && i+1 < len) || (tree[i] != '(' && tree[i] != ')')) throw "Malformed tree: unbalanced parentheses."; // The root can only be closed by the last parenthesis
+        H = std::max(I(h), H); // Also compute max height
     }
+    if (h != 1) throw "Malformed tree: unbalanced parentheses.";
     // Compute the partial sums in T[0...H-1]
-    uint32_t psum = 0, tmp;
-    for (uint32_t i = 0; i < H; ++i) {
+    I psum = 0, tmp;
+    for (I i = 0; i < H; ++i) {
         tmp = t[i];
         t[i] = psum;
         psum += tmp;
     }
     // Count the number of children for each node. We store this info in T[H...H+n-1]
     h = 0;
-    for (uint32_t i = 1; i < tree.length(); ++i) {
+    for (size_t i = 1; i < len; ++i) {
         t[H+t[h]] += (tree[i] == '(');
-        if (t[H+t[h]] > max_deg) throw "Tree is too big: out-degree overflow."; // Check for out-degree overflow
+        if (t[H+t[h]] > max_deg<I>) throw "Tree is too big: out-degree overflow."; // Check for out-degree overflow
         t[h] += (tree[i] == ')');
         h += ((tree[i] == '(')? 1 : -1);
     }
-    for (uint32_t i = 0; i < n; ++i) t[i] = t[i+H]; // Left-shift T[H...H+n-1] to T[0...n-1]
-    // Build basic T representation (no parent-children pointers)
-    uint32_t r = n; // T[r] is the number of children of last allocated node
-    uint32_t R = N; // Start position (=ID) in T of last allocated node
-    for(uint32_t i = 0; i < n; ++i) {
-        --r; // Process next node (right to left)
-        R -= (2 * t[r]) + 2; // Node ID
-        t[R] = t[r]; // Number of children
+    linkTree(t, n, H);
+}
+
+// Build minimal T structure from balanced parenthesis representation [level-wise, in-place]
+// @param tree      BP representation of tree
+// @param len       length of the BP representation
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+inline vector<I> buildTree(const char *tree, const size_t len) { // Complexity: O(n)
+    vector<I> t;
+    buildTree(tree, len, t);
+    return t;
+}
+
+// Build minimal T structure from balanced parenthesis representation
+// @param tree      BP representation of tree
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+inline vector<I> buildTree(const string &tree) { // Complexity: O(n)
+    return buildTree<I>(tree.data(), tree.length());
+}
+
+// Build minimal T structure from packed balanced parenthesis representation [level-wise, in-place, word-at-a-time]
+// Parentheses are processed as runs of equal bits, found with 'ctz' on whole words; the header (if it provides them) avoids tracking the max height and checking for out-degree overflow.
+// @param h         header of the packed tree
+// @param bits      packed BP representation of tree (bit i of word i/64 is 1 for "(", 0 for ")")
+// @param t         output minimal T representation (no partial sizes) [its memory is reused]
+template<typename I>
+void buildTree(const struct bp_header &h, const uint64_t *bits, vector<I> &t) { // Complexity: O(n)
+    if (h.n == 0) throw "Malformed tree: empty.";
+    if (h.n > max_n<I>) throw "Tree is too big: index overflow.";
+    I n = h.n;
+    if (n <= 1) { // Single node
+        if ((bits[0] & 3) != 1) throw "Malformed tree: unbalanced parentheses.";
+        t.assign(3, 0); return;
     }
-    // Set parent-children pointers
-    uint32_t i = 0, j = 2*t[0] + 2; // 'i' is at level L, 'j' is at level L+1
-    t[1] = 0; // Parent of root = root
-    while (j < N) {
-        uint32_t x = i; // This node
-        uint32_t nc = t[x]; // Number of children of this node
-        i += 2; // Jump to children area
-        for (int k = 0; k < nc; ++k) {
-            t[i] = j; // Write child's ID
-            i += 2; // Jump to next child 
-            t[j+1] = x; // Store parent of 'j'
-            j += 2*t[j]+2; // Jump to next child's area
+    uint64_t len = 2*h.n, words = (len + 63) / 64;
+    I N = (5 * n) - 2; // Size of T
+    t.assign(N, 0); // Empty T
+    // Check the number of "(" with 'popcount'
+    uint64_t open = 0;
+    for (uint64_t w = 0; w < words; ++w) open += __builtin_popcountll(bits[w] & ((w+1 < words || len%64 == 0)? ~0ull : (1ull << (len%64)) - 1));
+    if (open != n) throw "Malformed tree: unbalanced parentheses.";
+    // Compute the number of nodes per level in T[0...H-1]
+    if (h.max_depth > h.n) throw "Malformed tree: header mismatch."; // A tree of n nodes has at most n levels [T[0...H-1] must fit before T[H...H+n-1]]
+    I H = ((h.max_depth)? h.max_depth + 1 : 0); // Max height [known in advance if the header provides it]
+    uint64_t H_max = ((h.max_depth)? H : n + 1); // Bound on the height
+    uint64_t H_seen = 0; // Max height reached by the parentheses
+    int64_t d = 1; // Current height
+    for (uint64_t i = 0; i < len; ) {
+        uint64_t w = bits[i/64] >> (i%64), rem = std::min<uint64_t>(64 - i%64, len - i); // Bits left in the current word
+        uint64_t k = std::min<uint64_t>(((w & 1)? ((~w)? __builtin_ctzll(~w) : 64) : ((w)? __builtin_ctzll(w) : 64)), rem); // Length of the run
+        if (w & 1) {
+            if (uint64_t(d) + k > H_max) throw "Malformed tree: header mismatch.";
+            for (uint64_t j = 0; j < k; ++j) ++t[d-1+j];
+            d += k;
+            H_seen = std::max(uint64_t(d), H_seen); // Also compute max height
+        } else {
+            d -= k;
+            if (d < 1 || (d == 1 && i+k < len)) throw "Malformed tree: unbalanced parentheses."; // The root can only be closed by the last parenthesis
         }
+        i += k;
+    }
+    if (d != 1) throw "Malformed tree: unbalanced parentheses.";
+    if (h.max_depth && H_seen != H) throw "Malformed tree: header mismatch."; // The header overstates the number of levels
+    H = H_seen;
+    // Compute the partial sums in T[0...H-1]
+    I psum = 0, tmp;
+    for (I i = 0; i < H; ++i) {
+        tmp = t[i];
+        t[i] = psum;
+        psum += tmp;
     }
+    // Count the number of children for each node. We store this info in T[H...H+n-1]
+    bool check = (!h.max_deg || h.max_deg > max_deg<I>); // Check for out-degree overflow only if the header doesn't rule it out
+    d = 0;
+    for (uint64_t i = 1; i < len; ) {
+        uint64_t w = bits[i/64] >> (i%64), rem = std::min<uint64_t>(64 - i%64, len - i); // Bits left in the current word
+        uint64_t k = std::min<uint64_t>(((w & 1)? ((~w)? __builtin_ctzll(~w) : 64) : ((w)? __builtin_ctzll(w) : 64)), rem); // Length of the run
+        if (w & 1) { // Each "(" adds a child to the current node of its level
+            for (uint64_t j = 0; j < k; ++j) {
+                ++t[H+t[d+j]];
+                if (check && t[H+t[d+j]] > max_deg<I>) throw "Tree is too big: out-degree overflow.";
+            }
+            d += k;
+        } else { // Each ")" moves to the next node of its level
+            for (uint64_t j = 0; j < k; ++j) ++t[d-j];
+            d -= k;
+        }
+        i += k;
+    }
+    linkTree(t, n, H);
+}
+
+// Build minimal T structure from packed balanced parenthesis representation [level-wise, in-place, word-at-a-time]
+// @param h         header of the packed tree
+// @param bits      packed BP representation of tree (bit i of word i/64 is 1 for "(", 0 for ")")
+// @return          minimal T representation (no partial sizes)
+template<typename I = uint32_t>
+inline vector<I> buildTree(const struct bp_header &h, const uint64_t *bits) { // Complexity: O(n)
+    vector<I> t;
+    buildTree(h, bits, t);
     return t;
 }
 
 // Build a reference vector to identify the positions of the nodes in T
-// @param t     minimal T representation
-// @return      nodes reference vector
-vector<uint32_t> buildIdRef(const vector<uint32_t> &t) { // Complexity: O(n)
-    vector<uint32_t> id_ref = vector<uint32_t>(sizeOfT(t));
-    uint32_t i = 0, j = 0;
+// @param t         minimal T representation
+// @param id_ref    output nodes reference vector [its memory is reused]
+template<typename I>
+void buildIdRef(const vector<I> &t, vector<I> &id_ref) { // Complexity: O(n)
+    id_ref.resize(sizeOfT(t));
+    I i = 0, j = 0;
     while (i < t.size()) {
         id_ref[j] = i;
-        i += 2*(t[i]&num_c)+2; ++j; // Next node
+        i += 2*(t[i]&num_c<I>)+3; ++j; // Next node
     }
+}
+
+// Build a reference vector to identify the positions of the nodes in T
+// @param t     minimal T representation
+// @return      nodes reference vector
+template<typename I>
+inline vector<I> buildIdRef(const vector<I> &t) { // Complexity: O(n)
+    vector<I> id_ref;
+    buildIdRef(t, id_ref);
     return id_ref;
 }
 
+// Compute the max out-degree of a tree
+// @param t     T representation
+// @return      max number of children of a node
+template<typename I>
+I maxDegree(const vector<I> &t) { // Complexity: O(n)
+    I d = 0;
+    for (size_t i = 0; i < t.size(); i += 2*(t[i]&num_c<I>)+3) d = std::max<I>(d, t[i]&num_c<I>);
+    return d;
+}
+
 // Compute the initial partial sizes on T
 // @param t         minimal T representation
 // @param id_ref    nodes reference vector
-void computeSizes(vector<uint32_t> &t, const vector<uint32_t> &id_ref) { // Complexity: O(n)
-    uint32_t p = t.size(); // Parent (invalid at beginning)
-    uint32_t nc = 0; // 'i' is the 'nc'-th child of 'p'
+template<typename I>
+void computeSizes(vector<I> &t, const vector<I> &id_ref) { // Complexity: O(n)
+    I p = t.size(); // Parent (invalid at beginning)
+    I nc = 0; // 'i' is the 'nc'-th child of 'p'
     for (auto it = id_ref.rbegin(); it != id_ref.rend()-1; ++it) {
-        uint32_t i = *it; // ID of node
-        nc = ((t[parnt(i)] != p)? (t[t[parnt(i)]]&num_c)-1 : nc-1);
+        I i = *it; // ID of node
+        nc = ((t[parnt(i)] != p)? (t[t[parnt(i)]]&num_c<I>)-1 : nc-1);
         p = t[parnt(i)];
-        uint32_t size = 1; for (uint32_t j = 0; j < (t[i]&num_c); ++j) size += t[sizeOfChildOnT(i, j)]; // Size of subtree rooted at 'i'
+        I size = 1; for (I j = 0; j < (t[i]&num_c<I>); ++j) size += t[sizeOfChildOnT(i, j)]; // Size of subtree rooted at 'i'
         t[sizeOfChildOnT(p, nc)] = size;
     }
 }
 
+// Sort the cover elements lexicographically by depth and preorder rank [LSD radix sort: stable passes on 11-bit digits, the preorder rank ones first, skipping the digits above the biggest key]
+// Each chunk of 'q' counts its own digits, so that the scatter is done in parallel as well, and stays stable.
+// @param q         cover elements, as tuples <depth, pre_ord, size, t_node>
+// @param aux       buffer of the passes [its memory is reused]
+// @param cnt       buffer of the digit counters [its memory is reused]
+// @param threads   number of threads [used for big cover sets only]
+template<typename I>
+void sortCover(vector<tuple<I,I,I,I>> &q, vector<tuple<I,I,I,I>> &aux, vector<size_t> &cnt, const uint32_t threads = 1) { // Complexity: O(m) where m = q.size()
+    constexpr uint32_t bits = 11, R = 1 << bits;
+    size_t m = q.size();
+    uint32_t p = ((m >= (1 << 16))? std::max(threads, 1u) : 1);
+    I max_depth = 0, max_pre = 0;
+    for (auto &e : q) { max_depth = std::max(max_depth, std::get<0>(e)); max_pre = std::max(max_pre, std::get<1>(e)); }
+    pair<bool,uint32_t> passes[2*((8*sizeof(I)+bits-1)/bits)]; // Pairs <is depth digit, shift>
+    uint32_t np = 0; // Number of passes
+    for (uint32_t sh = 0; sh < 8*sizeof(I) && (uint64_t(max_pre) >> sh); sh += bits) passes[np++] = {false, sh};
+    for (uint32_t sh = 0; sh < 8*sizeof(I) && (uint64_t(max_depth) >> sh); sh += bits) passes[np++] = {true, sh};
+    aux.resize(m);
+    cnt.resize(size_t(p)*R);
+    for (uint32_t k = 0; k < np; ++k) {
+        auto [d, sh] = passes[k];
+        auto digit = [d = d, sh = sh](const tuple<I,I,I,I> &e) { return ((d? std::get<0>(e) : std::get<1>(e)) >> sh) & (R-1); };
+        auto run = [&](auto f) { if (p == 1) f(0, m, 0); else parallelFor(p, m, f); };
+        std::fill(cnt.begin(), cnt.end(), 0);
+        run([&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) ++cnt[j*R + digit(q[i])]; }); // Count
+        size_t sum = 0;
+        for (uint32_t x = 0; x < R; ++x) for (uint32_t j = 0; j < p; ++j) { size_t c = cnt[j*R + x]; cnt[j*R + x] = sum; sum += c; } // Offsets [by digit, then by chunk]
+        run([&](uint64_t b, uint64_t e, uint32_t j) { for (uint64_t i = b; i < e; ++i) aux[cnt[j*R + digit(q[i])]++] = q[i]; }); // Scatter
+        q.swap(aux);
+    }
+}
+
+// Sort the cover elements lexicographically by depth and preorder rank
+// @param q         cover elements, as tuples <depth, pre_ord, size, t_node>
+// @param threads   number of threads [used for big cover sets only]
+template<typename I>
+inline void sortCover(vector<tuple<I,I,I,I>> &q, const uint32_t threads = 1) { // Complexity: O(m) where m = q.size()
+    vector<tuple<I,I,I,I>> aux;
+    vector<size_t> cnt;
+    sortCover(q, aux, cnt, threads);
+}
+
 // Cover T and build T2, then compute partial sizes on T
 // Note: 'computeSizes()' shouldn't be called: this procedure already computes those sizes
 // @param t         minimal T representation
 // @param id_ref    nodes reference vector
+// @param t2        output T2 minimal representation (no weights) [its memory is reused]
+// @param cs        scratch space [its memory is reused]
 // @param A         minimum size of cover elements - log(n) if not given
-// @return          T2 minimal representation (no weights)
-vector<uint32_t> cover(vector<uint32_t> &t, const vector<uint32_t> &id_ref, uint32_t A = 0) { // Complexity: O(n)
-    uint32_t n = sizeOfT(t); // Number of nodes of T
-    A = ((!A)? ((n <= 1)? 1 : log2(n)) : A); // If A is not given
+// @param threads   number of threads [for sorting the cover elements]
+template<typename I>
+void cover(vector<I> &t, const vector<I> &id_ref, vector<I> &t2, struct cover_scratch<I> &cs, uint32_t A = 0, const uint32_t threads = 1) { // Complexity: O(n)
+    I n = sizeOfT(t); // Number of nodes of T
+    A = ((!A)? ((n <= 1)? 1 : log2(uint64_t(n))) : A); // If A is not given
     if (A > max_A) throw "\"A\" parameter is too big: maximum is 65535.";
-    uint32_t k = n/A + ((n%A == 0)? 0 : 1) + 1; // Upper-bound for number of nodes of T2
-    vector<uint32_t> X = vector<uint32_t>(n);
-    vector<tuple<uint32_t,uint32_t,uint32_t,uint32_t>> q = vector<tuple<uint32_t,uint32_t,uint32_t,uint32_t>>(k); // Fields: depth, pre_ord, size, t_node
-    uint32_t q_ptr = q.size() - 1; // Pointer on 'q'
+    I k = n/A + ((n%A == 0)? 0 : 1) + 1; // Upper-bound for number of nodes of T2
+    vector<I> &X = cs.x; X.assign(n, 0);
+    vector<tuple<I,I,I,I>> &q = cs.q; q.assign(k, tuple<I,I,I,I>()); // Fields: depth, pre_ord, size, t_node
+    I q_ptr = q.size() - 1; // Pointer on 'q'
     // Step 1 - bottom-up visit [compute partial sizes on T and perform covering]: O(n)
     int64_t i, p = t.size(), nc = 0;
     auto x = (uint16_t*)X.data(); // Here we use the first n bytes of 'X'
-    uint32_t x1_ptr = 0, x2_ptr = 0; // 'x1_ptr' is at level L, 'x2_ptr' is at level L+1
+    I x1_ptr = 0, x2_ptr = 0; // 'x1_ptr' is at level L, 'x2_ptr' is at level L+1
     for (auto it = id_ref.rbegin(); it != id_ref.rend(); ++it) {
-        i = *it; nc = ((t[parnt(i)] != p)? (t[t[parnt(i)]]&num_c)-1 : nc-1); p = t[parnt(i)];
+        i = *it; nc = ((t[parnt(i)] != p)? int64_t(t[t[parnt(i)]]&num_c<I>)-1 : nc-1); p = t[parnt(i)];
         // Compute partial and cover elements sizes
         t[sizeOfChildOnT(p, nc)] = ((i != 0)? 1 : t[sizeOfChildOnT(p, nc)]);
-        uint32_t size = 1;
-        for (uint32_t j = (t[i]&num_c); j > 0; --j, ++x2_ptr) {
+        I size = 1;
+        for (I j = (t[i]&num_c<I>); j > 0; --j, ++x2_ptr) {
             t[sizeOfChildOnT(p, nc)] += ((i != 0)? t[sizeOfChildOnT(i, j-1)] : 0);
             size += x[x2_ptr];
         }
         // Create cover element
         if (size >= A || i == 0) {
-            t[i] |= cov_el; // Mark node on T as cover element
+            t[i] |= cov_el<I>; // Mark node on T as cover element
             std::get<2>(q[q_ptr]) = size; // Write 'size' on 'q'
             std::get<3>(q[q_ptr]) = i; // Write 't_node' on 'q'
             --q_ptr;
@@ -131,23 +316,23 @@ vector<uint32_t> cover(vector<uint32_t> &t, const vector<uint32_t> &id_ref, uint
     }
     // Step 2 - top-down visit [compute 'depth' and 'pre-ord' fields for each node on T2]: O(n)
     i = 0; p = 0; ++q_ptr; X[0] = 0;
-    uint32_t p_depth = 0, pre_ord, X0_ptr = 0, X1_ptr = 0, X2_ptr = 1; // 'X0_ptr' is at level L-1, 'X1_ptr' is at level L and 'X2_ptr' is at level L+1
+    I p_depth = 0, pre_ord, X0_ptr = 0, X1_ptr = 0, X2_ptr = 1; // 'X0_ptr' is at level L-1, 'X1_ptr' is at level L and 'X2_ptr' is at level L+1
     while (i < t.size()) {
-        k = p + 2*(t[p]&num_c) + 2; // Next node on T (in BFS visit)
-        X0_ptr += ((t[parnt(i)] != p)? (t[parnt(i)]-k+2)/2 : 0);
+        k = p + 2*(t[p]&num_c<I>) + 3; // Next node on T (in BFS visit)
+        X0_ptr += ((t[parnt(i)] != p)? (t[parnt(i)]-k+3)/3 : 0); // Nodes between 'p' and the new parent are leaves
         p_depth = ((t[parnt(i)] != p || t[parnt(i)] == 0)? X[X0_ptr] : p_depth);
         p = t[parnt(i)];
         pre_ord = X[X1_ptr];
         // Compute and save 'pre_ord' field for 'i''s children
-        uint32_t s = 1 + pre_ord;
-        for (uint32_t j = 0; j < (t[i]&num_c); ++j, ++X2_ptr) {
+        I s = 1 + pre_ord;
+        for (I j = 0; j < (t[i]&num_c<I>); ++j, ++X2_ptr) {
             X[X2_ptr] = s;
             s += t[sizeOfChildOnT(i, j)];
         }
         // Save 'pre_ord' on 'q' for node 'i' if it is marked as cover element
         // Then compute and save 'depth' for node 'i'
-        uint32_t z = 0;
-        if (t[i]&cov_el) {
+        I z = 0;
+        if (t[i]&cov_el<I>) {
             z = 1;
             std::get<1>(q[q_ptr]) = pre_ord; // Save 'pre_ord'
             std::get<0>(q[q_ptr]) = p_depth + z; // Save 'depth'
@@ -155,46 +340,60 @@ vector<uint32_t> cover(vector<uint32_t> &t, const vector<uint32_t> &id_ref, uint
         }
         X[X1_ptr] = p_depth + z;
         ++X1_ptr;
-        i += 2*(t[i]&num_c)+2;
+        i += 2*(t[i]&num_c<I>)+3;
     }
     // Step 3 - build minimal T2 [no parent-children pointers]: O(n/log(n))
-    std::sort(q.begin(), q.end()); // Sort 'q' lexicographically (first 'depth', then 'pre_ord')
-    uint32_t q1_ptr = 0, q2_ptr; while (std::get<2>(q[q1_ptr]) == 0) ++q1_ptr; q2_ptr = q1_ptr + 1; // Position 'q1_ptr' at first tuple, 'q2_ptr' at the next one
-    uint32_t m = q.size() - q1_ptr; // Number of nodes of T2
-    vector<uint32_t> t2 = vector<uint32_t>(7*m-3);
+    sortCover(q, cs.aux, cs.cnt, threads); // Sort 'q' lexicographically (first 'depth', then 'pre_ord')
+    I q1_ptr = 0, q2_ptr; while (std::get<2>(q[q1_ptr]) == 0) ++q1_ptr; q2_ptr = q1_ptr + 1; // Position 'q1_ptr' at first tuple, 'q2_ptr' at the next one
+    I m = q.size() - q1_ptr; // Number of nodes of T2
+    t2.assign(8*m-3, 0);
     i = 0;
     while (i < t2.size()) {
         t2[i+2] = std::get<2>(q[q1_ptr]); // Size of subtree
         t2[i+3] = std::get<3>(q[q1_ptr]); // ID reference on T
-        i += 4; nc = 0;
+        i += 5; nc = 0;
         if (q1_ptr+1 < q.size()) { // If this isn't the last tuple
             if (std::get<0>(q[q1_ptr+1]) > std::get<0>(q[q1_ptr])) { // If next node is at level L+1, then all nodes at L+1, starting from 'q2_ptr', are 'i''s children
-                uint32_t l = std::get<0>(q[q1_ptr]) + 1; // Level L+1
+                I l = std::get<0>(q[q1_ptr]) + 1; // Level L+1
                 while (q2_ptr < q.size() && std::get<0>(q[q2_ptr]) == l) {
                     ++nc; ++q2_ptr;
                     i += 3;
                 }
             } else { // Otherwise
-                uint32_t l = std::get<0>(q[q1_ptr]) + 1; // Level L+1
+                I l = std::get<0>(q[q1_ptr]) + 1; // Level L+1
                 while (q2_ptr < q.size() && std::get<0>(q[q2_ptr]) == l && std::get<1>(q[q2_ptr]) < std::get<1>(q[q1_ptr+1])) { // Count 'i''s children at L+1 using 'pre_ord'
                     ++nc; ++q2_ptr;
                     i += 3;
                 }
             }
         }
-        t2[i-3*nc-4] = nc; // Write number of children
+        t2[i-3*nc-5] = nc; // Write number of children
         ++q1_ptr;
     }
     // Step 4 - compute parent-children pointers: O(n/log(n))
     i = 0;
-    uint32_t j = 3*t2[i]+4; // Second node in BFS
+    I j = childOnT2(i, t2[i]); // Second node in BFS
     while (i < t2.size()) {
-        for (uint32_t k = 0; k < t2[i]; ++k) {
-            t2[childOnT2(i, k)] = j; t2[parnt(j)] = i;
+        for (I k = 0; k < t2[i]; ++k) {
+            t2[childOnT2(i, k)] = j; t2[parnt(j)] = i; t2[slotOnT2(j)] = k;
             j += childOnT2(0, t2[j]); // Next child
         }
         i += childOnT2(0, t2[i]); // Next node
     }
+}
+
+// Cover T and build T2, then compute partial sizes on T
+// Note: 'computeSizes()' shouldn't be called: this procedure already computes those sizes
+// @param t         minimal T representation
+// @param id_ref    nodes reference vector
+// @param A         minimum size of cover elements - log(n) if not given
+// @param threads   number of threads [for sorting the cover elements]
+// @return          T2 minimal representation (no weights)
+template<typename I>
+inline vector<I> cover(vector<I> &t, const vector<I> &id_ref, uint32_t A = 0, const uint32_t threads = 1) { // Complexity: O(n)
+    vector<I> t2;
+    struct cover_scratch<I> cs;
+    cover(t, id_ref, t2, cs, A, threads);
     return t2;
 }
 
@@ -205,30 +404,28 @@ vector<uint32_t> cover(vector<uint32_t> &t, const vector<uint32_t> &id_ref, uint
 // Remove a node 'n' from T
 // @param t     T representation
 // @param n     ID of the note to be removed
-inline void rmNodeOnT(vector<uint32_t> &t, const uint32_t n) { // Complexity: O(k) where k = t[t[n+1]]
-    uint32_t p = t[parnt(n)];
-    uint32_t size; for (uint32_t i = 0; i < (t[p]&num_c); ++i) if (t[childOnT(p, i)] == n) size = t[sizeOfChildOnT(p, i)]; // Size of 'n'
+template<typename I>
+inline void rmNodeOnT(vector<I> &t, const I n) { // Complexity: O(d+k) where d = depth of 'n' in its connected component and k = t[n]
+    I p = t[parnt(n)];
     // Delete references inside 'n''s parent
     if (p != n) { // If 'n' has a parent
-        for (uint32_t i = 0; i < (t[p]&num_c); ++i) { // Search among its 'p''s children
-            if (t[childOnT(p, i)] == n) { // Node found
-                // Swap its ID and size with the last valid child's ID and size
-                uint32_t aux_id = t[childOnT(p, i)], aux_size = t[sizeOfChildOnT(p, i)];
-                t[childOnT(p, i)] = t[childOnT(p, (t[p]&num_c)-1)]; t[sizeOfChildOnT(p, i)] = t[sizeOfChildOnT(p, (t[p]&num_c)-1)];
-                t[childOnT(p, (t[p]&num_c)-1)] = aux_id; t[sizeOfChildOnT(p, (t[p]&num_c)-1)] = aux_size;
-                break; // Stop searching
-            }
-        }
+        I i = t[slotOnT(n)], l = (t[p]&num_c<I>)-1; // Position of 'n' and of the last valid child among 'p''s children
+        I size = t[sizeOfChildOnT(p, i)]; // Size of 'n'
+        // Swap its ID and size with the last valid child's ID and size
+        I aux_id = t[childOnT(p, i)], aux_size = t[sizeOfChildOnT(p, i)];
+        t[childOnT(p, i)] = t[childOnT(p, l)]; t[sizeOfChildOnT(p, i)] = t[sizeOfChildOnT(p, l)];
+        t[childOnT(p, l)] = aux_id; t[sizeOfChildOnT(p, l)] = aux_size;
+        t[slotOnT(t[childOnT(p, i)])] = i; t[slotOnT(n)] = l;
         --t[p]; // Decrement 'p''s number of children
         // Update partial sizes on T
-        uint32_t m = p; p = t[parnt(m)]; // Starting from 'p'
+        I m = p; p = t[parnt(m)]; // Starting from 'p'
         while (m != p) { // Navigate up the tree
-            for (uint32_t i = 0; i < (t[p]&num_c); ++i) if (t[childOnT(p, i)] == m) t[sizeOfChildOnT(p, i)] -= size;
+            t[sizeOfChildOnT(p, t[slotOnT(m)])] -= size;
             m = p; p = t[parnt(m)]; // Step up
         }
     }
     // Delete references inside 'n''s children
-    for (uint32_t i = 0; i < (t[n]&num_c); ++i) t[parnt(t[childOnT(n, i)])] = t[childOnT(n, i)];
+    for (I i = 0; i < (t[n]&num_c<I>); ++i) t[parnt(t[childOnT(n, i)])] = t[childOnT(n, i)];
 }
 
 // Add a node on T2
@@ -237,160 +434,305 @@ inline void rmNodeOnT(vector<uint32_t> &t, const uint32_t n) { // Complexity: O(
 // @param ref           reference ID on T
 // @param size          size of treelet
 // @param children      vector of the children of the new node
+// @param deltas        first delta of each child (i.e. total size of the treelets of its subtree)
 // @return              ID of the newly added node
-inline uint32_t addNodeOnT2(vector<uint32_t> &t2, const uint32_t ref, const uint32_t size, const vector<uint32_t> &children) { // Complexity: O(k) where k = children.size()
-    uint32_t id = t2.size(); // ID of the new node
+template<typename I>
+inline I addNodeOnT2(vector<I> &t2, const I ref, const I size, const vector<I> &children, const vector<I> &deltas) { // Complexity: O(k) where k = children.size()
+    I id = t2.size(); // ID of the new node
     t2.pb(children.size()); // Number of children
     t2.pb(id); // Parent ID (i.e. itself, see assumption above)
     t2.pb(size); // Size of treelet
     t2.pb(ref); // Treelet root ID reference on T
-    for (uint32_t child : children) {
+    t2.pb(0); // Position among its parent's children
+    for (I k = 0; k < children.size(); ++k) {
+        I child = children[k];
         t2.pb(child); // Child ID
-        t2.pb(0); t2.pb(0); // Empty deltas (will be computed by the proper function)
-        t2[child+1] = id; // Update child's parent ID
+        t2.pb(deltas[k]); t2.pb(0); // Deltas [the second one is not maintained]
+        t2[parnt(child)] = id; t2[slotOnT2(child)] = k; // Update child's parent ID and position
     }
     return id;
 }
 
 // Remove a node 'n' from T2
-// @param t2    T2 representation
-// @param n     ID of the node to be removed
-// @return      vector with the children of the removed node
-inline vector<uint32_t> rmNodeOnT2(vector<uint32_t> &t2, const uint32_t n) { // Complexity: O(k) where k = _t[_t[n+1]]
-    uint32_t p = t2[parnt(n)]; // Parent of the node ID
+// @param t2        T2 representation
+// @param n         ID of the node to be removed
+// @param children  output vector with the children of the removed node
+// @param deltas    output vector with the first delta of each child
+template<typename I>
+inline void rmNodeOnT2(vector<I> &t2, const I n, vector<I> &children, vector<I> &deltas) { // Complexity: O(k) where k = _t[_t[n+1]]
+    I p = t2[parnt(n)]; // Parent of the node ID
     // Delete references inside 'n''s parent
     if (p != n) {
-        for (uint32_t i = 0; i < t2[p]; ++i) { // Search among 'p' children
-            if (t2[childOnT2(p, i)] == n) { // Node found
-                // Swap its ID and deltas with the last valid child's ID and deltas
-                uint32_t aux_id = t2[childOnT2(p, i)], aux_delta_1 = t2[delta1OfChildOnT2(p, i)], aux_delta_2 = t2[delta2OfChildOnT2(p, i)];
-                t2[childOnT2(p, i)] = t2[childOnT2(p, t2[p]-1)]; t2[delta1OfChildOnT2(p, i)] = t2[delta1OfChildOnT2(p, t2[p]-1)]; t2[delta2OfChildOnT2(p, i)] = t2[delta2OfChildOnT2(p, t2[p]-1)];
-                t2[childOnT2(p, t2[p]-1)] = aux_id; t2[delta1OfChildOnT2(p, t2[p]-1)] = aux_delta_1; t2[delta2OfChildOnT2(p, t2[p]-1)] = aux_delta_2;
-                break; // Stop searching
-            }
-        }
+        I i = t2[slotOnT2(n)], l = t2[p]-1; // Position of 'n' and of the last valid child among 'p''s children
+        // Swap its ID and deltas with the last valid child's ID and deltas
+        I aux_id = t2[childOnT2(p, i)], aux_delta_1 = t2[delta1OfChildOnT2(p, i)], aux_delta_2 = t2[delta2OfChildOnT2(p, i)];
+        t2[childOnT2(p, i)] = t2[childOnT2(p, l)]; t2[delta1OfChildOnT2(p, i)] = t2[delta1OfChildOnT2(p, l)]; t2[delta2OfChildOnT2(p, i)] = t2[delta2OfChildOnT2(p, l)];
+        t2[childOnT2(p, l)] = aux_id; t2[delta1OfChildOnT2(p, l)] = aux_delta_1; t2[delta2OfChildOnT2(p, l)] = aux_delta_2;
+        t2[slotOnT2(t2[childOnT2(p, i)])] = i; t2[slotOnT2(n)] = l;
         --t2[p]; // Decrement 'p''s number of children
     }
     // Delete references inside 'n''s children
-    vector<uint32_t> children;
-    for (uint32_t i = 0; i < t2[n]; ++i) { // Navigate the children
+    children.clear(); deltas.clear();
+    for (I i = 0; i < t2[n]; ++i) { // Navigate the children
         t2[parnt(t2[childOnT2(n, i)])] = t2[childOnT2(n, i)]; // And make them new roots of subtrees
-        children.pb(t2[childOnT2(n, i)]);
+        children.pb(t2[childOnT2(n, i)]); deltas.pb(t2[delta1OfChildOnT2(n, i)]);
     }
-    return children;
 }
 
 // Standard centroid search algorithm
 // @param t         T representation
 // @param root      root of the connected component
 // @return          centroid of the connected component
-inline uint32_t stdFindCentroid(const vector<uint32_t> &t, const uint32_t root) { // Complexity: O(n)
-    // Compute half size of subtree: O(k) where k = (t[root]&num_c)
-    uint32_t half_size = 1; for (uint32_t i = 0; i < (t[root]&num_c); ++i) half_size += t[sizeOfChildOnT(root, i)];
-    half_size /= 2;
+template<typename I>
+inline I stdFindCentroid(const vector<I> &t, const I root) { // Complexity: O(n)
+    // Compute half size of subtree: O(k) where k = (t[root]&num_c<I>)
+    I half_size = (1 + sumOf<2>(t.data()+sizeOfChildOnT(root, 0), t[root]&num_c<I>)) / 2;
     // Centroid search: O(n)
-    uint32_t centroid = root; // Start search from root
-    bool found = false;
-    if ((t[centroid]&num_c) > 0) {
-        while (!found) {
-            for (uint32_t i = 0 ; i < (t[centroid]&num_c); ++i) {
-                if (t[sizeOfChildOnT(centroid, i)] > half_size) { // Look for heavy child
-                    centroid = t[childOnT(centroid, i)];
-                    found = false; break;
-                } else found = true; // Centroid found
-            }
-        }
-    }
+    I centroid = root; // Start search from root
+    for (uint64_t i; (i = firstGreater<2>(t.data()+sizeOfChildOnT(centroid, 0), t[centroid]&num_c<I>, half_size)) < (t[centroid]&num_c<I>);) centroid = t[childOnT(centroid, i)]; // Heavy child
     return centroid;
 }
 
+// Every decomposition writes its output through the following functions, so that the same loop fills either the BP shape and IDs of a 'basic_c_tree' or the parent and depth arrays of a 'basic_c_parents'.
+// Parents are filled in place: when a connected component is pushed, its parent centroid is written on its root, and the centroid chosen from it inherits that parent.
+
+// Initialize the output structure
+// @param ct        output centroid tree
+// @param t         T representation [before the decomposition]
+template<typename I>
+inline void initOutput(basic_c_tree<I> &ct, const vector<I> &t) { // Complexity: O(n)
+    ct.shape.init(2*size_t(sizeOfT(t)));
+    ct.ids.assign(sizeOfT(t), 0);
+}
+
+// Initialize the output structure
+// @param cp        output centroid tree [as parent and depth arrays]
+// @param t         T representation [before the decomposition]
+template<typename I>
+inline void initOutput(basic_c_parents<I> &cp, const vector<I> &t) { // Complexity: O(n)
+    cp.rank.init(t);
+    cp.par.assign(sizeOfT(t), 0); // The root of T is its own parent, i.e. its connected component has no parent centroid
+    cp.depth.assign(sizeOfT(t), 0);
+}
+
+// Print a centroid to the output structure
+// Note: the region of 'ct.shape' reserved to the connected component must be zeroed, and "(" are thus left as they are [other threads may write to the words at its ends]
+// @param ct        output centroid tree
+// @param ptr1      position in 'ct.shape' [moved past the centroid]
+// @param ptr2      position in 'ct.ids' [moved past the centroid]
+// @param r         root of the connected component
+// @param centroid  centroid of the connected component
+// @param c         number of nodes of the connected component, centroid excluded
+template<typename I>
+inline void printCentroid(basic_c_tree<I> &ct, size_t &ptr1, size_t &ptr2, const I r, const I centroid, const size_t c) { // Complexity: O(1) amortized
+    while (ct.shape.getSync(ptr1) == 1) ++ptr1; // Go past "closed" nodes, the next "(" is already there
+    ct.ids[ptr2] = centroid; // Print centroid ID
+    ++ptr1; ++ptr2;
+    ct.shape.setSync(ptr1+2*c); // Print ")"
+}
+
+// Print a centroid to the output structure
+// @param cp        output centroid tree [as parent and depth arrays]
+// @param ptr1      unused
+// @param ptr2      unused
+// @param r         root of the connected component
+// @param centroid  centroid of the connected component
+// @param c         unused
+template<typename I>
+inline void printCentroid(basic_c_parents<I> &cp, size_t &ptr1, size_t &ptr2, const I r, const I centroid, const size_t c) { // Complexity: O(1)
+    I x = cp.rank(r), y = cp.rank(centroid), p = cp.par[x]; // Parent centroid, written on the root [if not the root of T]
+    cp.par[y] = ((p == x)? y : p);
+    cp.depth[y] = ((p == x)? 0 : cp.depth[p]+1);
+}
+
+// Print the root of a new connected component to the output structure [to be called after 'printCentroid()' on the component it comes from]
+// @param ct        output centroid tree
+// @param root      root of the new connected component
+// @param centroid  centroid that created it
+template<typename I>
+inline void printComponent(basic_c_tree<I> &ct, const I root, const I centroid) {} // Complexity: O(1)
+
+// Print the root of a new connected component to the output structure [to be called after 'printCentroid()' on the component it comes from]
+// @param cp        output centroid tree [as parent and depth arrays]
+// @param root      root of the new connected component
+// @param centroid  centroid that created it
+template<typename I>
+inline void printComponent(basic_c_parents<I> &cp, const I root, const I centroid) { // Complexity: O(1)
+    cp.par[cp.rank(root)] = cp.rank(centroid);
+}
+
 // Standard centroid decomposition algorithm
 // @param t         T representation
 // @param root      root of the tree (or connected component, used as subprocedure for linear centroid decomposition)
 // @param N         number of nodes of the tree to elaborate (required ONLY when called as subprocedure of linear centroid decomposition)
 // @return          pair<shape,ids> (struct) representation of the centroid tree
-inline struct c_tree stdCentroidDecomposition(vector<uint32_t> &t, const uint32_t root = 0, uint32_t N = 0) { // Complexity: O(n*log(n))
+template<typename I>
+inline basic_c_tree<I> stdCentroidDecomposition(vector<I> &t, const I root = 0, I N = 0) { // Complexity: O(n*log(n))
     N = ((!N)? sizeOfT(t) : N);
-    struct c_tree ct;
-    ct.shape = vector<uint8_t>(2*N, 0);
-    ct.ids = vector<uint32_t>(N, 0);
-    uint32_t ptr1 = 0, ptr2 = 0; // 'ptr1' for 'shape', 'ptr2' for 'ids'
-    // struct stk s; s.init(N); s.push(root); // Stack with roots of connected components yet to process
-    stack<int> s; s.push(root);
+    basic_c_tree<I> ct;
+    ct.shape.init(2*size_t(N));
+    ct.ids = vector<I>(N, 0);
+    I ptr1 = 0, ptr2 = 0; // 'ptr1' for 'shape', 'ptr2' for 'ids'
+    // stk<I> s; s.init(N); s.push(root); // Stack with roots of connected components yet to process
+    stack<I> s; s.push(root);
     while (!s.empty()) {
-        uint32_t r = s.top(); s.pop();
-        uint32_t c = 0; for (uint32_t i = 0; i < (t[r]&num_c); ++i) c+= t[sizeOfChildOnT(r, i)]; // Total size of future connected components [used for printing output]
-        uint32_t centroid = stdFindCentroid(t, r);
+        I r = s.top(); s.pop();
+        I c = sumOf<2>(t.data()+sizeOfChildOnT(r, 0), t[r]&num_c<I>); // Total size of future connected components [used for printing output]
+        I centroid = stdFindCentroid(t, r);
         rmNodeOnT(t, centroid);
-        for(uint32_t i = (t[centroid]&num_c); i > 0; --i) s.push(t[childOnT(centroid, i-1)]); // Push children to stack in reverse order
+        for(I i = (t[centroid]&num_c<I>); i > 0; --i) s.push(t[childOnT(centroid, i-1)]); // Push children to stack in reverse order
         if (centroid != r) s.push(r); // If the root of the subtree is not its centroid, then push it
         // Print the current node to the output structure
         while (ct.shape[ptr1] == 1) ++ptr1;
-        ct.shape[ptr1] = 0; // Print "("
+        ct.shape.set(ptr1, 0); // Print "("
         ct.ids[ptr2] = centroid; // Print centroid ID
         ++ptr1; ++ptr2;
-        ct.shape[ptr1+2*c] = 1; // Print ")"
+        ct.shape.set(ptr1+2*c); // Print ")"
     }
     return ct;
 }
 
+// Standard centroid decomposition algorithm (with global stack, writing directly to the final output structure)
+// @param s         global custom stack (in order to avoid reallocations of memory)
+// @param t         T representation
+// @param out       output structure [centroid tree, or parent and depth arrays]
+// @param root      root of the connected component
+// @param N         number of nodes of the connected component
+// @param ptr1      position of the connected component in 'ct.shape' [moved past its last centroid]
+// @param ptr2      position of the connected component in 'ct.ids' [moved past its last centroid]
+template<typename I, typename O>
+inline void stdCentroidDecomposition(stk<I> &s, vector<I> &t, O &out, const I root, const I N, size_t &ptr1, size_t &ptr2) { // Complexity: O(n*log(n))
+    s.push(root);
+    while (!s.empty()) {
+        I r = s.top(); s.pop();
+        I c = sumOf<2>(t.data()+sizeOfChildOnT(r, 0), t[r]&num_c<I>); // Total size of future connected components [used for printing output]
+        I centroid = stdFindCentroid(t, r);
+        rmNodeOnT(t, centroid);
+        printCentroid(out, ptr1, ptr2, r, centroid, c); // Print the current node to the output structure
+        for(I i = (t[centroid]&num_c<I>); i > 0; --i) { s.push(t[childOnT(centroid, i-1)]); printComponent(out, s.top(), centroid); }
+        if (centroid != r) { s.push(r); printComponent(out, r, centroid); }
+    }
+}
+
 // Standard centroid decomposition algorithm (with global stack)
 // @param s         global custom stack (in order to avoid reallocations of memory)
 // @param t         T representation
 // @param root      root of the tree (or connected component, used as subprocedure for linear centroid decomposition)
 // @param N         number of nodes of the tree to elaborate (required ONLY when called as subprocedure of linear centroid decomposition)
 // @return          pair<shape,ids> (struct) representation of the centroid tree
-inline struct c_tree stdCentroidDecomposition(struct stk &s, vector<uint32_t> &t, const uint32_t root = 0, uint32_t N = 0) { // Complexity: O(n*log(n))
+template<typename I>
+inline basic_c_tree<I> stdCentroidDecomposition(stk<I> &s, vector<I> &t, const I root = 0, I N = 0) { // Complexity: O(n*log(n))
     N = ((!N)? sizeOfT(t) : N);
-    struct c_tree ct;
-    ct.shape = vector<uint8_t>(2*N, 0);
-    ct.ids = vector<uint32_t>(N, 0);
-    uint32_t ptr1 = 0, ptr2 = 0; // 'ptr1' for 'shape', 'ptr2' for 'ids'
-    s.push(root);
-    while (!s.empty()) {
-        uint32_t r = s.top(); s.pop();
-        uint32_t c = 0; for (uint32_t i = 0; i < (t[r]&num_c); ++i) c+= t[sizeOfChildOnT(r, i)]; // Total size of future connected components [used for printing output]
-        uint32_t centroid = stdFindCentroid(t, r);
-        rmNodeOnT(t, centroid);
-        for(uint32_t i = (t[centroid]&num_c); i > 0; --i) s.push(t[childOnT(centroid, i-1)]);
-        if (centroid != r) s.push(r);
-        // Print the current node to the output structure
-        while (ct.shape[ptr1] == 1) ++ptr1;
-        ct.shape[ptr1] = 0; // Print "("
-        ct.ids[ptr2] = centroid; // Print centroid ID
-        ++ptr1; ++ptr2;
-        ct.shape[ptr1+2*c] = 1; // Print ")"
-    }
+    basic_c_tree<I> ct;
+    ct.shape.init(2*size_t(N));
+    ct.ids = vector<I>(N, 0);
+    size_t ptr1 = 0, ptr2 = 0;
+    stdCentroidDecomposition(s, t, ct, root, N, ptr1, ptr2);
     return ct;
 }
 
+// Standard centroid decomposition algorithm, filling the parent and depth arrays of the centroid tree
+// @param t         T representation
+// @param cp        output centroid tree [as parent and depth arrays]
+template<typename I>
+inline void stdCentroidDecomposition(vector<I> &t, basic_c_parents<I> &cp) { // Complexity: O(n*log(n))
+    I N = sizeOfT(t);
+    initOutput(cp, t);
+    stk<I> s; s.init(N);
+    size_t ptr1 = 0, ptr2 = 0;
+    stdCentroidDecomposition(s, t, cp, I(0), N, ptr1, ptr2);
+}
+
+// Copy a connected component of T to a local tree [BFS from its root]
+// @param t         T representation
+// @param lt        output local tree
+// @param root      root of the connected component
+// @param N         number of nodes of the connected component
+template<typename I, typename L>
+inline void gatherComponent(const vector<I> &t, local_tree<I,L> &lt, const I root, const I N) { // Complexity: O(N)
+    lt.id[0] = root; lt.v[0].par = 0; lt.v[0].slot = 0;
+    size_t c = 1; // Local ID of the next child
+    for (size_t u = 0; u < N; ++u) {
+        I g = lt.id[u], k = t[g]&num_c<I>;
+        lt.v[u].nc = k; lt.v[u].off = c-1;
+        for (I i = 0; i < k; ++i, ++c) {
+            lt.id[c] = t[childOnT(g, i)];
+            lt.v[c].par = u; lt.v[c].slot = i;
+            lt.kids[c-1] = c;
+        }
+    }
+    for (size_t u = N-1; u > 0; --u) lt.csize[lt.v[lt.v[u].par].off + lt.v[u].slot] = 1 + sumOf(lt.csize.data()+lt.v[u].off, lt.v[u].nc); // Children come after their parent
+}
+
+// Standard centroid decomposition algorithm on a local copy of a connected component [same choices of the algorithm on T, hence the same output, but T is left untouched]
+// @param lt        local tree (scratch space, with room for 'N' nodes)
+// @param t         T representation
+// @param out       output structure [centroid tree, or parent and depth arrays]
+// @param root      root of the connected component
+// @param N         number of nodes of the connected component
+// @param ptr1      position of the connected component in 'ct.shape' [moved past its last centroid]
+// @param ptr2      position of the connected component in 'ct.ids' [moved past its last centroid]
+template<typename I, typename L, typename O>
+inline void smallCentroidDecomposition(local_tree<I,L> &lt, const vector<I> &t, O &out, const I root, const I N, size_t &ptr1, size_t &ptr2) { // Complexity: O(N*log(N))
+    gatherComponent(t, lt, root, N);
+    auto &v = lt.v;
+    L *cs = lt.csize.data();
+    size_t k = 0; lt.s[k++] = 0;
+    while (k > 0) {
+        L r = lt.s[--k];
+        L c = sumOf(cs+v[r].off, v[r].nc); // Total size of future connected components [used for printing output]
+        // Centroid search
+        L half_size = (c+1) / 2, centroid = r;
+        for (uint64_t i; (i = firstGreater(cs+v[centroid].off, v[centroid].nc, half_size)) < v[centroid].nc;) centroid = lt.kids[v[centroid].off+i]; // Heavy child
+        // Remove the centroid
+        L p = v[centroid].par;
+        if (p != centroid) {
+            L i = v[centroid].slot, l = v[p].nc-1; // Position of the centroid and of the last valid child among 'p''s children
+            L size = cs[v[p].off+i];
+            std::swap(lt.kids[v[p].off+i], lt.kids[v[p].off+l]); std::swap(cs[v[p].off+i], cs[v[p].off+l]);
+            v[lt.kids[v[p].off+i]].slot = i; v[centroid].slot = l;
+            --v[p].nc;
+            for (L m = p; v[m].par != m; m = v[m].par) cs[v[v[m].par].off + v[m].slot] -= size; // Update partial sizes up to the root
+        }
+        printCentroid(out, ptr1, ptr2, lt.id[r], lt.id[centroid], c); // Print the current node to the output structure
+        for (L i = v[centroid].nc; i > 0; --i) { L u = lt.kids[v[centroid].off+i-1]; v[u].par = u; lt.s[k++] = u; printComponent(out, lt.id[u], lt.id[centroid]); }
+        if (centroid != r) { lt.s[k++] = r; printComponent(out, lt.id[r], lt.id[centroid]); }
+    }
+}
+
+// Decompose a small connected component in the scratch space of the kernel [with the narrowest local IDs that fit it]
+// @param sc        scratch space (with room for 'N' nodes)
+// @param t         T representation
+// @param out       output structure [centroid tree, or parent and depth arrays]
+// @param root      root of the connected component
+// @param N         number of nodes of the connected component
+// @param ptr1      position of the connected component in 'ct.shape' [moved past its last centroid]
+// @param ptr2      position of the connected component in 'ct.ids' [moved past its last centroid]
+template<typename I, typename O>
+inline void smallCentroidDecomposition(small_scratch<I> &sc, vector<I> &t, O &out, const I root, const I N, size_t &ptr1, size_t &ptr2) { // Complexity: O(N*log(N))
+    if (uint64_t(N) <= numeric_limits<uint16_t>::max()) smallCentroidDecomposition(sc.l16, t, out, root, N, ptr1, ptr2);
+    else if (uint64_t(N) <= numeric_limits<uint32_t>::max()) smallCentroidDecomposition(sc.l32, t, out, root, N, ptr1, ptr2);
+    else { stk<I> s; s.init(N); stdCentroidDecomposition(s, t, out, root, N, ptr1, ptr2); } // Too big for local IDs: work on T
+}
+
 /*
  * NEW O(n) CENTROID DECOMPOSITION IMPLEMENTATION
  */
 
-// Recompute the deltas on a connected component of T2
-// @param t         T representation
+// Compute the first delta of every edge of T2, i.e. the total size of the treelets below it [once, before the decomposition: the splits then keep them up to date]
+// The second delta (size of the connected component minus the first one) is not maintained, as the size of the component is known from T.
 // @param t2        T2 representation
-// @param root      root of the connected component of which to compute deltas
-inline void computeDeltas(const vector<uint32_t> &t, vector<uint32_t> &t2, const uint32_t root) { // Complexity: O(log(n))
-    // Compute total size of treelet
-    uint32_t size = 1; for (uint32_t i = 0; i < (t[t2[alpha(root)]]&num_c); ++i) size += t[sizeOfChildOnT(t2[alpha(root)], i)];
-    // Build stack for DFS
-    // struct stk s; s.init(size); s.push(root);
-    stack<int> s; s.push(root);
-    // struct stk dfs; dfs.init(size);
-    stack<int> dfs;
-    while (!s.empty()) {
-        uint32_t node = s.top(); s.pop();
-        dfs.push(node);
-        for (uint32_t i = t2[node]; i > 0; --i) s.push(t2[childOnT2(node, i-1)]); // Push children
-    }
-    // DFS on T2 and compute deltas
-    while (!dfs.empty()) {
-        uint32_t node = dfs.top(); dfs.pop();
-        for (uint32_t i = 0; i < t2[node]; ++i) {
-            t2[delta1OfChildOnT2(node, i)] = t2[t2[childOnT2(node, i)]+2]; for (uint32_t j = 0; j < t2[t2[childOnT2(node, i)]]; ++j) t2[delta1OfChildOnT2(node, i)] += t2[delta1OfChildOnT2(t2[childOnT2(node, i)], j)]; // Delta 1
-            t2[delta2OfChildOnT2(node, i)] = size - t2[delta1OfChildOnT2(node, i)]; // Delta 2
+// @param order     scratch vector for the nodes of T2
+template<typename I>
+inline void computeDeltas(vector<I> &t2, vector<I> &order) { // Complexity: O(m) where m = number of nodes of T2
+    order.clear();
+    for (size_t i = 0; i < t2.size(); i += childOnT2(0, t2[i])) order.pb(i); // BFS order [every node comes after its parent]
+    for (auto it = order.rbegin(); it != order.rend(); ++it) { // Bottom-up
+        I node = *it;
+        for (I i = 0; i < t2[node]; ++i) {
+            I c = t2[childOnT2(node, i)], d = t2[c+2];
+            for (I j = 0; j < t2[c]; ++j) d += t2[delta1OfChildOnT2(c, j)];
+            t2[delta1OfChildOnT2(node, i)] = d;
         }
     }
 }
@@ -399,17 +741,17 @@ inline void computeDeltas(const vector<uint32_t> &t, vector<uint32_t> &t2, const
 // @param t         T representation
 // @param t2        T2 representation
 // @param root      root of the connected component
+// @param size      size of the connected component
 // @return          centroid of the connected component (both IDs on T and T2)
-inline pair<uint32_t,uint32_t> findCentroid(const vector<uint32_t> &t, const vector<uint32_t> &t2, const uint32_t root) { // Complexity: O(n/log(n)+log(n))
-    // Compute half size of connected component: O(1)
-    uint32_t half_size = ((t2[root] == 0)? t2[root+2] : t2[delta1OfChildOnT2(root, 0)]+t2[delta2OfChildOnT2(root, 0)]);
-    half_size /= 2; // Compute size
+template<typename I>
+inline pair<I,I> findCentroid(const vector<I> &t, const vector<I> &t2, const I root, const I size) { // Complexity: O(n/log(n)+log(n))
+    I half_size = size / 2;
     // Serach centroid treelet on T2: O(n/log(n))
-    uint32_t centroid_treelet = root; // Start searching from root
+    I centroid_treelet = root; // Start searching from root
     bool found = false;
     while (!found) {
         if (t2[centroid_treelet] > 0) {
-            for (uint32_t i = 0; i < t2[centroid_treelet]; ++i) { // Search heavy child
+            for (I i = 0; i < t2[centroid_treelet]; ++i) { // Search heavy child
                 if (t2[delta1OfChildOnT2(centroid_treelet, i)] > half_size) {
                     centroid_treelet = t2[childOnT2(centroid_treelet, i)];
                     found = false; break;
@@ -418,110 +760,136 @@ inline pair<uint32_t,uint32_t> findCentroid(const vector<uint32_t> &t, const vec
         } else found = true;
     }
     // Search centroid node on T [visit subtree]: O(log(n))
-    uint32_t centroid_node = t2[alpha(centroid_treelet)];
-    found = false;
-    if ((t[centroid_node]&num_c) > 0) {
-        while (!found) {
-            for (uint32_t i = 0; i < (t[centroid_node]&num_c); ++i) { // Search heavy child
-                if (t[sizeOfChildOnT(centroid_node, i)] > half_size) {
-                    centroid_node = t[childOnT(centroid_node, i)];
-                    found = false; break;
-                } else found = true;
+    I centroid_node = t2[alpha(centroid_treelet)];
+    for (uint64_t i; (i = firstGreater<2>(t.data()+sizeOfChildOnT(centroid_node, 0), t[centroid_node]&num_c<I>, half_size)) < (t[centroid_node]&num_c<I>);) centroid_node = t[childOnT(centroid_node, i)]; // Heavy child
+    return make_pair(centroid_treelet, centroid_node);
+}
+
+// Split a connected component (bigger than threshold 'B') at its centroid
+// @param t         T representation
+// @param t2        T2 representation
+// @param r         root on T2 of the connected component
+// @param size      size of the connected component
+// @param sc        scratch space ['sc.comps' gets the roots on T2 of the new connected components, in stack order]
+// @return          centroid on T
+template<typename I>
+inline I splitComponent(vector<I> &t, vector<I> &t2, const I r, const I size, cd_scratch<I> &sc) { // Complexity: O(n/log(n)+log(n)) amortized
+    pair<I,I> centroid = findCentroid(t, t2, r, size); I t2c = centroid.first, tc = centroid.second; // Centroid on T and T2
+    // Update the deltas on the path from 't2c' to the root of T2, whose subtrees lose the one of 'tc' [the deltas below that path do not change]
+    if (t2c != r) {
+        I s_tc = t[sizeOfChildOnT(t[parnt(tc)], t[slotOnT(tc)])]; // Size of the subtree of 'tc'
+        for (I n = t2c, p = t2[parnt(n)]; n != p; n = p, p = t2[parnt(n)]) t2[delta1OfChildOnT2(p, t2[slotOnT2(n)])] -= s_tc;
+    }
+    rmNodeOnT(t, tc);
+    vector<I> &children = sc.children, &deltas = sc.deltas; rmNodeOnT2(t2, t2c, children, deltas);
+    // Build children reference vector
+    vector<pair<I,I>> &c_ref = sc.c_ref; c_ref.clear();
+    vector<I> &comps = sc.comps; comps.clear();
+    for (I child : children) {
+        I n = t2[alpha(child)], p = t[parnt(n)];
+        while (p != n) { n = p; p = t[parnt(n)]; }
+        c_ref.pb(make_pair(n, child));
+    }
+    // Bucket the children reference vector by the child of 'tc' they hang from, keeping their order [the last bucket is for the part above 'tc']
+    I nc = (t[tc]&num_c<I>); // Number of children
+    constexpr I none = numeric_limits<I>::max();
+    vector<I> &head = sc.head, &next = sc.next;
+    for (I i = 0; i <= nc; ++i) head[i] = none;
+    next.resize(c_ref.size());
+    for (I j = c_ref.size(); j > 0; --j) {
+        I key = ((c_ref[j-1].first == t2[alpha(r)])? nc : t[slotOnT(c_ref[j-1].first)]);
+        next[j-1] = head[key]; head[key] = j-1;
+    }
+    // Build new nodes on T2 for each 'tc''s children
+    I total_number = 0; // Total number of old T2 nodes whose parent has been found [used when updating 'tc''s parent]
+    I total_size = 1; // Total size of the newly created nodes on T2 [used when updating 'tc''s parent]
+    for (I i = nc; i > 0; --i) {
+        I new_node;
+        I child = t[childOnT(tc, i-1)];
+        if (!(t[child]&cov_el<I>)) { // If 'child' isn't a cover element
+            t[child] |= cov_el<I>;
+            I size = t[sizeOfChildOnT(tc, i-1)]; total_size += size;
+            vector<I> &c = sc.c, &cd = sc.cd; c.clear(); cd.clear();
+            for (I j = head[i-1]; j != none; j = next[j]) { // For each node on T2 whose new parent is the new node being created
+                I node = c_ref[j].second;
+                c.pb(node); cd.pb(deltas[j]);
+                size -= deltas[j]; total_size -= deltas[j]; // Size decrement [total size of the treelets below 'node']
+                ++total_number;
             }
+            new_node = addNodeOnT2(t2, child, size, c, cd);
+        } else if (head[i-1] != none) { // Otherwise, the child is the root of a node on T2
+            new_node = c_ref[head[i-1]].second;
+            ++total_number;
         }
+        comps.pb(new_node); // Push new connected component
     }
-    return make_pair(centroid_treelet, centroid_node);
+    // If necessary, update nodes on T2 for 'tc''s parent
+    if (t2[alpha(t2c)] != tc) { // If the centroid is not the root of its cover element
+        // Undo 't2c' deletion and update its parameters
+        I parent = t2[parnt(t2c)];
+        if (parent != t2c) ++t2[parent]; // Get back reference on 't2c''s parent
+        t2[t2c] -= total_number; // Decrement number of children on T2
+        t2[t2c+2] -= total_size;
+        I i = 0;
+        for (I j = head[nc]; j != none; j = next[j]) { // For each node on T2 attached "before" than 'tc'
+            I node = c_ref[j].second;
+            t2[childOnT2(t2c, i)] = node; t2[delta1OfChildOnT2(t2c, i)] = deltas[j]; // Then add its ID (and its unchanged delta) among the updated 't2c''s children
+            t2[parnt(node)] = t2c; t2[slotOnT2(node)] = i; // And set 't2c' as its parent
+            ++i;
+        }
+    }
+    if (t[parnt(tc)] != tc) comps.pb(r); // If centroid on T has a parent
+    return tc;
 }
 
 // New centroid decomposition algorithm
 // @param t         T representation
 // @param t2        T2 representation
+// @param out       output structure, i.e. centroid tree pair<shape,ids> (struct) representation, or parent and depth arrays [its memory is reused]
+// @param b         scratch space [its memory is reused]
 // @param B         threshold for standard centroid decomposition - (log(n))^3 if not given
-// @return          centroid tree pair<shape,ids> (struct) representation
-struct c_tree centroidDecomposition(vector<uint32_t> &t, vector<uint32_t> &t2, uint32_t B = 0) { // Complexity: O(n)
-    uint32_t n = (t.size() + 2) / 4;
-    B = ((n <= 1)? 1 : ((!B)? (log2(n)*log2(n)*log2(n)) : B));
-    struct c_tree ct;
-    ct.shape = vector<uint8_t>(2*n, 0);
-    ct.ids = vector<uint32_t>(n, 0);
-    uint32_t ptr1 = 0, ptr2 = 0;
-    // struct stk s; s.init(n); s.push(0); // Stack with roots of connected components yet to process
-    stack<int> s; s.push(0);
-    struct stk aux_s; aux_s.init(B); // Global auxiliary stack for standard centroid decomposition
+// @param perf      report in which to measure the small-component fallback [optional]
+template<typename I, typename O>
+void centroidDecomposition(vector<I> &t, vector<I> &t2, O &out, struct cd_buffers<I> &b, uint64_t B = 0, struct perf_report *perf = nullptr) { // Complexity: O(n)
+    I n = sizeOfT(t);
+    B = ((n <= 1)? 1 : ((!B)? (uint64_t(log2(uint64_t(n)))*log2(uint64_t(n))*log2(uint64_t(n))) : B));
+    initOutput(out, t);
+    size_t ptr1 = 0, ptr2 = 0;
+    stk<I> &s = b.s; s.init(n); s.push(0); // Stack with roots of connected components yet to process
+    small_scratch<I> &ss = b.ss; ss.init(std::min<uint64_t>(B, n)); // Scratch space for the small components
+    cd_scratch<I> &sc = b.sc; sc.init(sizeOfT2(t2), maxDegree(t)); // Scratch space for the splits
+    computeDeltas(t2, sc.order);
+    t2.reserve(2*t2.size()); // Room for the new nodes on T2
+    uint32_t ph1 = ((perf)? perf->phase("Component splits") : 0), ph2 = ((perf)? perf->phase("Small components (local kernel)") : 0);
+    bool small = false; // Is a measurement of 'ph2' open? [consecutive small components are measured together]
     while (!s.empty()) {
-        uint32_t r = s.top(); s.pop();
-        uint32_t size = 1; for (uint32_t i = 0; i < (t[t2[alpha(r)]]&num_c); ++i) size += t[sizeOfChildOnT(t2[alpha(r)], i)]; // Size of connected component
+        I r = s.top(), tr = t2[alpha(r)]; s.pop(); // Root on T2 and on T
+        I size = 1 + sumOf<2>(t.data()+sizeOfChildOnT(tr, 0), t[tr]&num_c<I>); // Size of connected component
         if (size > B) { // If connected component is bigger than threshold 'B'
-            computeDeltas(t, t2, r);
-            pair<uint32_t,uint32_t> centroid = findCentroid(t, t2, r); uint32_t t2c = centroid.first, tc = centroid.second; // Centroid on T and T2
-            rmNodeOnT(t, tc);
-            vector<uint32_t> children = rmNodeOnT2(t2, t2c);
-            // Build children reference vector
-            vector<pair<uint32_t,uint32_t>> c_ref;
-            for (uint32_t child : children) {
-                uint32_t n = t2[alpha(child)], p = t[parnt(n)];
-                while (p != n) { n = p; p = t[parnt(n)]; }
-                c_ref.pb(make_pair(n, child));
-            }
-            // Build new nodes on T2 for each 'tc''s children
-            uint32_t nc = (t[tc]&num_c); // Number of children [used for printing centroid tree]
-            uint32_t total_number = 0; // Total number of old T2 nodes whose parent has been found [used when updating 'tc''s parent]
-            uint32_t total_size = 1; // Total size of the newly created nodes on T2 [used when updating 'tc''s parent]
-            for (uint32_t i = nc; i > 0; --i) {
-                uint32_t new_node;
-                uint32_t child = t[childOnT(tc, i-1)];
-                if (!(t[child]&cov_el)) { // If 'child' isn't a cover element
-                    t[child] |= cov_el;
-                    uint32_t size = t[sizeOfChildOnT(tc, i-1)]; total_size += size;
-                    vector<uint32_t> c;
-                    for (pair<uint32_t,uint32_t> node : c_ref) { // For each node in 'c_ref' (i.e. a node on T2 whose new parent has to be found)
-                        if (child == node.first) { // If its new parent is the new node being created
-                            c.pb(node.second);
-                            uint32_t size_dec = 1; for (uint32_t j = 0; j < (t[t2[alpha(node.second)]]&num_c); ++j) size_dec += t[sizeOfChildOnT(t2[alpha(node.second)], j)]; // Size decrement
-                            size -= size_dec; total_size -= size_dec;
-                            ++total_number;
-                        }
-                    }
-                    new_node = addNodeOnT2(t2, child, size, c);
-                } else {
-                    for (pair<uint32_t,uint32_t> node : c_ref) {
-                        if (child == node.first) {
-                            new_node = node.second;
-                            ++total_number; break;
-                        }
-                    }
-                }
-                s.push(new_node); // Push new connected component to stack
-            }
-            // If necessary, update nodes on T2 for 'tc''s parent
-            if (t2[alpha(t2c)] != tc) { // If the centroid is not the root of its cover element
-                // Undo 't2c' deletion and update its parameters
-                uint32_t parent = t2[parnt(t2c)];
-                if (parent != t2c) ++t2[parent]; // Get back reference on 't2c''s parent
-                t2[t2c] -= total_number; // Decrement number of children on T2
-                t2[t2c+2] -= total_size;
-                uint32_t i = 0;
-                for (pair<uint32_t,uint32_t> node : c_ref) {
-                    if (t2[alpha(r)] == node.first) { // If it was attached "before" than 'tc'
-                        t2[childOnT2(t2c, i)] = node.second; // Then add its ID among the updated 't2c''s children
-                        t2[parnt(node.second)] = t2c; // And set 't2c' as its parent
-                        ++i;
-                    }
-                }
-            }
-            if (t[parnt(tc)] != tc) { s.push(r); ++nc; } // If centroid on T has a parent
-            // Print node to output vectors
-            ct.shape[ptr1] = 0; // Print "("
-            ct.ids[ptr2] = tc; // Print centroid ID
-            ++ptr1; ++ptr2;
-            ct.shape[ptr1+2*(size-1)] = 1; // Print ")"
+            if (small) { perf->end(ph2); small = false; }
+            perf_scope ps(perf, ph1);
+            I tc = splitComponent(t, t2, r, size, sc);
+            printCentroid(out, ptr1, ptr2, tr, tc, size-1); // Print node to output vectors
+            for (I comp : sc.comps) { s.push(comp); printComponent(out, t2[alpha(comp)], tc); } // Push new connected components to stack
         } else { // If connected component is smaller than threshold 'B'
-            struct c_tree tmp = stdCentroidDecomposition(aux_s, t, t2[alpha(r)], size);
-            for (uint8_t el : tmp.shape) { ct.shape[ptr1] = el; ++ptr1; } // Copy shape
-            for (uint32_t el : tmp.ids) { ct.ids[ptr2] = el; ++ptr2; } // Copy ids
+            if (perf && !small) { perf->begin(ph2); small = true; }
+            smallCentroidDecomposition(ss, t, out, tr, size, ptr1, ptr2); // Write directly to the output
         }
-        while (ptr1 < ct.shape.size() && ct.shape[ptr1] == 1) ++ptr1; // Go past "closed" nodes
     }
+    if (small) perf->end(ph2);
+}
+
+// New centroid decomposition algorithm
+// @param t         T representation
+// @param t2        T2 representation
+// @param B         threshold for standard centroid decomposition - (log(n))^3 if not given
+// @param perf      report in which to measure the small-component fallback [optional]
+// @return          centroid tree pair<shape,ids> (struct) representation
+template<typename I>
+inline basic_c_tree<I> centroidDecomposition(vector<I> &t, vector<I> &t2, uint64_t B = 0, struct perf_report *perf = nullptr) { // Complexity: O(n)
+    basic_c_tree<I> ct;
+    struct cd_buffers<I> b;
+    centroidDecomposition(t, t2, ct, b, B, perf);
     return ct;
 }
 
@@ -529,43 +897,136 @@ struct c_tree centroidDecomposition(vector<uint32_t> &t, vector<uint32_t> &t2, u
  * CORRECTNESS CHECK
  */
 
-// Check correctness of a centroid decomposition
-// @param t         T representation
+// Recover the original tree from the positions of its nodes on T
+// T is laid out in BFS order, so the children of a node are a contiguous range of BFS ranks, and each node takes 2*nc+3 words: this also holds after the decomposition, which destroys the content of T but not its layout.
+// @param id_ref    nodes reference vector
+// @param N         size of T
+// @param first     output BFS rank of the first child of each node, followed by the number of nodes
+// @param par       output parent of each node (the root is its own parent)
+template<typename I>
+void recoverTree(const vector<I> &id_ref, const size_t N, vector<I> &first, vector<I> &par) { // Complexity: O(n)
+    I n = id_ref.size();
+    first = vector<I>(n+1); first[n] = n;
+    par = vector<I>(n);
+    I c = 1;
+    for (I v = 0; v < n; ++v) {
+        I nc = (((v+1 < n)? size_t(id_ref[v+1]) : N) - id_ref[v] - 3) / 2; // Number of children
+        first[v] = c;
+        for (I k = 0; k < nc; ++k) par[c+k] = v;
+        c += nc;
+    }
+    if (n > 0) par[0] = 0;
+}
+
+// Check correctness of a centroid decomposition, without touching T [the original tree is recovered from 'id_ref', so this also works after the decomposition]
+// The centroid tree is correct iff:
+// 1. it holds each node exactly once;
+// 2. each edge of the tree joins a node to one of its ancestors in the centroid tree;
+// 3. the centroid subtree of each node has an edge to the parent centroid [by 2. and by induction, each centroid subtree is then connected, and the subtrees of the children of a centroid are the components left by its removal];
+// 4. each centroid subtree holds at most half of the nodes of the subtree of its parent centroid.
 // @param ct        pair<shape,ids> (struct) representation of centroid tree
+// @param id_ref    nodes reference vector
+// @param N         size of T
 // @return          true if centroid tree is correct, false otherwise
-bool checkCorrectness(vector<uint32_t> &t, const struct c_tree &ct) { // Complexity: unknown and not relevant
-    vector<uint32_t> roots; roots.pb(0);
-    uint32_t N = sizeOfT(t);
-    // struct stk noc; noc.init(N); noc.push(1);
-    stack<int> noc; noc.push(1);
-    uint32_t i = 0, ptr = 0;
-    for (uint32_t el : ct.shape) {
-        if (el == 0) { // If "("
-            uint32_t id = ct.ids[ptr]; // ID of the node
-            ++ptr;
-            // Check correctness
-            bool found = false;
-            for (uint32_t j = roots.size()-noc.top(); j < roots.size(); ++j) {
-                uint32_t r = roots[j];
-                if (id == stdFindCentroid(t, r)) {
-                    found = true;
-                    roots.erase(roots.begin()+j);
-                    --noc.top();
-                    rmNodeOnT(t, id);
-                    uint32_t c = 0;
-                    for(uint32_t k = (t[id]&num_c); k > 0; --k) { roots.pb(t[childOnT(id, k-1)]); ++c; } // Centroid's children
-                    if (id != r) { roots.pb(r); ++c; }
-                    noc.push(c);
-                    break;
-                }
-            }
-            if (!found) return false;
-        } else if (el == 1) noc.pop(); // Else, if ")"
-        ++i;
+template<typename I>
+bool checkCorrectness(const basic_c_tree<I> &ct, const vector<I> &id_ref, const size_t N) { // Complexity: O(n*log(n))
+    const I none = numeric_limits<I>::max();
+    I n = id_ref.size();
+    if (ct.ids.size() != n || ct.shape.size() != 2*size_t(n)) return false;
+    vector<I> first, par; recoverTree(id_ref, N, first, par);
+    // Step 1 - preorder rank, subtree size and parent of each node on the centroid tree [nodes are identified by their BFS rank]
+    vector<I> pre(n, none), sz(n), cpar(n), order(n); // 'order' holds the nodes in preorder
+    vector<I> open; // Open nodes
+    I k = 0;
+    for (size_t i = 0; i < ct.shape.size(); ++i) {
+        if (!ct.shape[i]) { // If "("
+            if (k == n || (open.empty() && k > 0)) return false; // Too many nodes, or more than one root
+            I v = std::lower_bound(id_ref.begin(), id_ref.end(), ct.ids[k]) - id_ref.begin();
+            if (v == n || id_ref[v] != ct.ids[k] || pre[v] != none) return false; // Not a node, or repeated [1.]
+            pre[v] = k; order[k++] = v;
+            cpar[v] = ((open.empty())? v : open.back());
+            open.pb(v);
+        } else { // Else, if ")"
+            if (open.empty()) return false;
+            sz[open.back()] = k - pre[open.back()];
+            open.pop_back();
+        }
+    }
+    if (k != n || !open.empty()) return false;
+    for (I v = 0; v < n; ++v) if (cpar[v] != v && 2*uint64_t(sz[v]) > sz[cpar[v]]) return false; // [4.]
+    // Step 2 - children of each centroid, in preorder
+    vector<I> coff(n+1, 0), kids(n);
+    for (I v = 0; v < n; ++v) if (cpar[v] != v) ++coff[cpar[v]+1];
+    for (I v = 0; v < n; ++v) coff[v+1] += coff[v];
+    vector<I> fill(coff.begin(), coff.end()-1);
+    for (I j = 0; j < n; ++j) if (cpar[order[j]] != order[j]) kids[fill[cpar[order[j]]]++] = order[j];
+    // Step 3 - edges of the tree
+    vector<bool> linked(n, false); // Does the centroid subtree of the node have an edge to its parent centroid?
+    for (I v = 1; v < n; ++v) {
+        I a = par[v], b = v; // 'a' must be an ancestor of 'b' on the centroid tree, or vice versa
+        if (pre[a] > pre[b]) std::swap(a, b);
+        if (pre[b] >= pre[a] + sz[a]) return false; // [2.]
+        auto it = std::upper_bound(kids.begin()+coff[a], kids.begin()+coff[a+1], pre[b], [&](I x, I y) { return x < pre[y]; }); // Child of 'a' whose subtree holds 'b'
+        linked[*(it-1)] = true;
     }
+    for (I v = 0; v < n; ++v) if (cpar[v] != v && !linked[v]) return false; // [3.]
     return true;
 }
 
+// Check correctness of a centroid decomposition given as parent and depth arrays [turned into the pair<shape,ids> representation, then checked as such]
+// @param cp        centroid tree as parent and depth arrays
+// @param id_ref    nodes reference vector
+// @param N         size of T
+// @return          true if centroid tree is correct, false otherwise
+template<typename I>
+bool checkCorrectness(const basic_c_parents<I> &cp, const vector<I> &id_ref, const size_t N) { // Complexity: O(n*log(n))
+    I n = id_ref.size(), root = n;
+    if (cp.par.size() != n || cp.depth.size() != n) return false;
+    // Step 1 - children of each node on the centroid tree [counting sort by parent], checking that depths grow by one along them
+    vector<I> first(n+1, 0), kids(n);
+    for (I v = 0; v < n; ++v) {
+        if (cp.par[v] >= n) return false;
+        if (cp.par[v] == v) {
+            if (root != n || cp.depth[v] != 0) return false; // More than one root
+            root = v;
+        } else {
+            if (cp.depth[v] != cp.depth[cp.par[v]]+1) return false;
+            ++first[cp.par[v]+1];
+        }
+    }
+    if (root == n) return false;
+    for (I v = 0; v < n; ++v) first[v+1] += first[v];
+    vector<I> pos(first.begin(), first.end()-1);
+    for (I v = 0; v < n; ++v) if (cp.par[v] != v) kids[pos[cp.par[v]]++] = v;
+    // Step 2 - pair<shape,ids> representation [DFS from the root]
+    basic_c_tree<I> ct;
+    ct.shape.init(2*size_t(n)); ct.ids.reserve(n);
+    vector<pair<I,I>> s; // Stack of pairs <node, next child>
+    size_t i = 0;
+    ct.ids.pb(id_ref[root]); ++i; s.pb({root, first[root]});
+    while (!s.empty()) {
+        I v = s.back().first, k = s.back().second;
+        if (k < first[v+1]) {
+            ++s.back().second;
+            ct.ids.pb(id_ref[kids[k]]); ++i; // Print "("
+            s.pb({kids[k], first[kids[k]]});
+        } else {
+            ct.shape.set(i++); // Print ")"
+            s.pop_back();
+        }
+    }
+    return checkCorrectness(ct, id_ref, N);
+}
+
+// Check correctness of a centroid decomposition
+// @param t         T representation [before the decomposition]
+// @param ct        pair<shape,ids> (struct) representation of centroid tree
+// @return          true if centroid tree is correct, false otherwise
+template<typename I>
+inline bool checkCorrectness(const vector<I> &t, const basic_c_tree<I> &ct) { // Complexity: O(n*log(n))
+    return checkCorrectness(ct, buildIdRef(t), t.size());
+}
+
 /*
  * UTILS
  */
@@ -592,14 +1053,15 @@ inline string printTime(const string t, const chrono::high_resolution_clock::tim
     return os.str();
 }
 
-// Print a vector<uint32_t> [used for debugging purposes]
+// Print a vector<I> [used for debugging purposes]
 // @param t     general tree representation
 // @return      string representation of tree
-inline string print(const vector<uint32_t> &t) { // Complexity: O(n)
+template<typename I>
+inline string print(const vector<I> &t) { // Complexity: O(n)
     oss os;
     os << "(";
     bool first = true; // Used for the first element
-    for (const uint32_t i : t) {
+    for (const I i : t) {
         if (first) {
             os << i;
             first = false;
@@ -609,15 +1071,66 @@ inline string print(const vector<uint32_t> &t) { // Complexity: O(n)
     return os.str();
 }
 
+// Convert the representation of centroid tree from parent and depth arrays to string
+// @param cp    centroid tree as parent and depth arrays
+// @return      centroid tree string representation ("parent/depth" of each node, in BFS order)
+template<typename I>
+inline string cpToString(const basic_c_parents<I> &cp) { // Complexity: O(n)
+    oss os;
+    for (size_t v = 0; v < cp.par.size(); ++v) os << ((v > 0)? " " : "") << cp.par[v] << "/" << uint32_t(cp.depth[v]);
+    return os.str();
+}
+
+// Convert the representation of centroid tree from parent and depth arrays to string, with the original IDs of the nodes
+// @param cp        centroid tree as parent and depth arrays
+// @param labels    original ID of each node (in BFS order)
+// @return          centroid tree string representation ("parent/depth" of each node, in the order of the original IDs)
+template<typename I>
+inline string cpToString(const basic_c_parents<I> &cp, const vector<uint32_t> &labels) { // Complexity: O(n)
+    vector<uint32_t> node(labels.size()); // Node with each original ID
+    for (size_t v = 0; v < labels.size(); ++v) node[labels[v]] = v;
+    oss os;
+    for (size_t x = 0; x < node.size(); ++x) os << ((x > 0)? " " : "") << labels[cp.par[node[x]]] << "/" << uint32_t(cp.depth[node[x]]);
+    return os.str();
+}
+
+// Convert the representation of centroid tree from pair<shape,ids> to string
+// @param ct    centroid tree pair<shape,ids> (struct) representation
+// @param s     output string, to which the centroid tree is appended [its memory is reused]
+template<typename I>
+inline void ctToString(const basic_c_tree<I> &ct, string &s) { // Complexity: O(n)
+    char buf[24];
+    size_t ptr = 0;
+    for (size_t i = 0; i < ct.shape.size(); ++i) {
+        switch (ct.shape[i]) {
+            case 0: s += '('; s.append(buf, std::to_chars(buf, buf+sizeof(buf), ct.ids[ptr]).ptr - buf); ++ptr; break;
+            case 1: s += ')'; break;
+        }
+    }
+}
+
 // Convert the representation of centroid tree from pair<shape,ids> to string
 // @param ct    centroid tree pair<shape,ids> (struct) representation
 // @return      centroid tree string representation
-inline string ctToString(const struct c_tree &ct) { // Complexity: O(n)
+template<typename I>
+inline string ctToString(const basic_c_tree<I> &ct) { // Complexity: O(n)
+    string s;
+    ctToString(ct, s);
+    return s;
+}
+
+// Convert the representation of centroid tree from pair<shape,ids> to string, printing the original IDs of the nodes
+// @param ct        centroid tree pair<shape,ids> (struct) representation
+// @param id_ref    nodes reference vector
+// @param labels    original ID of each node (in BFS order)
+// @return          centroid tree string representation
+template<typename I>
+inline string ctToString(const basic_c_tree<I> &ct, const vector<I> &id_ref, const vector<uint32_t> &labels) { // Complexity: O(n*log(n))
     oss os;
-    uint32_t ptr = 0;
-    for (uint32_t el : ct.shape) {
-        switch (el) {
-            case 0: os << "(" << ct.ids[ptr]; ++ptr; break;
+    size_t ptr = 0;
+    for (size_t i = 0; i < ct.shape.size(); ++i) {
+        switch (ct.shape[i]) {
+            case 0: os << "(" << labels[std::lower_bound(id_ref.begin(), id_ref.end(), ct.ids[ptr]) - id_ref.begin()]; ++ptr; break;
             case 1: os << ")"; break;
         }
     }
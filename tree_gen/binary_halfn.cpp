@@ -3,15 +3,16 @@ using namespace std;
 
 // Generate binary tree with height n/2
 
-int main(int argc, char* argv[]) { // Args: 1 => number of nodes
+int main(int argc, char* argv[]) { // Args: 1 => number of nodes, [-b => packed BP format]
 	uint32_t n;
 	if (argc < 2) return 1;
 	else {
 		iss is(argv[1]);
 		is >> n; // Get number of nodes
 	}
-	for (uint32_t i = 0; i < n/2; i++) cout << "(()";
-	cout << "()";
-	for(uint32_t i = 0; i < n/2; i++) cout << ")";
+	bool packed = (string(argv[argc-1]) == "-b");
+	struct bp_writer w;
+	genBinaryHalfn(w, n);
+	w.write(cout, packed);
 	return 0;
 }
\ No newline at end of file
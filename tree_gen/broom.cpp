@@ -0,0 +1,19 @@
+#include "../src/main.hpp"
+using namespace std;
+
+// Generate broom of <n> nodes: a handle (path) of <k> nodes, the last of which has the remaining n-k nodes as leaves
+
+int main(int argc, char* argv[]) { // Args: 1 => number of nodes, args[2] => length of the handle (1 <= k <= n), [-b => packed BP format]
+    uint32_t n, k;
+    if (argc < 3) return 1;
+    else {
+        n = atoi(argv[1]);
+        k = atoi(argv[2]);
+    }
+    if (k < 1 || k > n) return 1;
+    bool packed = (string(argv[argc-1]) == "-b");
+    struct bp_writer w;
+    genBroom(w, n, k);
+    w.write(cout, packed);
+    return 0;
+}
@@ -0,0 +1,32 @@
+#include "../src/main.hpp"
+using namespace std;
+
+// Convert a tree from the text BP format to the packed one, or vice versa
+
+int main(int argc, char* argv[]) { // Args: 1 => input tree (text or packed BP format)
+	if (argc < 2) return 1;
+	struct mapped_file f;
+	try {
+		f = mapFile(argv[1]);
+		struct bp_writer w;
+		if (const struct bp_header *h = packedTree(f)) { // Packed => text
+			const uint64_t *bits = packedBits(f);
+			for (uint64_t i = 0; i < 2*h->n; ++i) ((bits[i/64] >> (i%64) & 1)? w.open() : w.close());
+			w.write(cout, false);
+		} else { // Text => packed
+			if (f.len < 2) throw "Malformed tree: empty.";
+			for (size_t i = 0; i < f.len; ++i) {
+				if (f.data[i] != '(' && (f.data[i] != ')' || w.depth == 0)) throw "Malformed tree: unbalanced parentheses.";
+				((f.data[i] == '(')? w.open() : w.close());
+				if (w.depth == 0 && i+1 < f.len) throw "Malformed tree: unbalanced parentheses."; // The root can only be closed by the last parenthesis
+			}
+			if (w.depth != 0) throw "Malformed tree: unbalanced parentheses.";
+			w.write(cout, true);
+		}
+	} catch (const char* err) {
+		cerr << err << nl;
+		return 1;
+	}
+	unmapFile(f);
+	return 0;
+}
@@ -0,0 +1,19 @@
+#include "../src/main.hpp"
+using namespace std;
+
+// Generate star of <n> nodes (root with n-1 leaves)
+
+int main(int argc, char* argv[]) { // Args: 1 => number of nodes, [-b => packed BP format]
+    uint32_t n;
+    if (argc < 2) return 1;
+    else {
+        iss is(argv[1]);
+        is >> n; // Get number of nodes
+    }
+    if (n < 1) return 1;
+    bool packed = (string(argv[argc-1]) == "-b");
+    struct bp_writer w;
+    genStar(w, n);
+    w.write(cout, packed);
+    return 0;
+}